@@ -0,0 +1,127 @@
+#include "alloc_budget.h"
+#include "alloc_counter.h"
+#include "benchclient.h"
+#include "traffic.h"
+#include "edhencoder.h"
+
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+
+#include <cmath>
+#include <cstdio>
+
+using namespace eDrillingHub;
+
+namespace {
+    struct Path {
+        QString name;
+        double measured;
+    };
+}
+
+template <typename Fn>
+static double allocationsPerMessage(int messages, Fn fn) {
+    // the first pass builds hashes, caches and lazily initialised statics
+    for (int i = 0; i < messages; i++) {
+        fn(i);
+    }
+
+    quint64 before = AllocCounter::count();
+    for (int i = 0; i < messages; i++) {
+        fn(i);
+    }
+    return double(AllocCounter::count() - before) / messages;
+}
+
+static QVector<Path> measure() {
+    Traffic traffic;
+    const int messages = 10000;
+    QVector<Path> paths;
+
+    BenchClient client;
+    QObject::connect(&client, &Client::tagValueUpdated, [](const QString&, const QDateTime&, QMetaType::Type, const QVariant&) {});
+    QStringList lines = traffic.subscriptionLines(1000, messages);
+    paths.append(Path{"subscription_scalar", allocationsPerMessage(messages, [&](int i) {
+        client.handle(lines[i]);
+    })});
+
+    QStringList tags;
+    for (int i = 0; i < 1000; i++) {
+        tags.append(traffic.tagName(i));
+    }
+    qint64 ts = 1546300800000;
+    QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(ts, Qt::UTC);
+    QVariant value(1234.5678);
+
+    paths.append(Path{"protocol_write_tag", allocationsPerMessage(messages, [&](int i) {
+        Protocol::WriteTag(tags[i % tags.size()], timestamp, value);
+    })});
+
+    CommandEncoder encoder;
+    paths.append(Path{"encoder_write_tag", allocationsPerMessage(messages, [&](int i) {
+        encoder.clear();
+        encoder.writeTag(tags[i % tags.size()], ts, value);
+    })});
+
+    return paths;
+}
+
+int AllocBudget::calibrate(const QString &path) {
+    if (! AllocCounter::available()) {
+        std::fprintf(stderr, "allocation counting needs glibc allocator interposition\n");
+        return 1;
+    }
+
+    QFile file(path);
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        std::fprintf(stderr, "edhclient_bench: unable to write %s\n", qPrintable(path));
+        return 1;
+    }
+
+    QTextStream out(&file);
+    out << "# allocations per message, measured steady state + " << int(Margin * 100) << "%\n";
+    for (const auto& measured : measure()) {
+        double budget = std::ceil(measured.measured * (1 + Margin));
+        out << measured.name << ' ' << budget << '\n';
+        std::printf("%-28s %8.2f allocs/msg  budget %8.2f\n", qPrintable(measured.name), measured.measured, budget);
+    }
+    return 0;
+}
+
+int AllocBudget::check(const QString &path) {
+    if (! AllocCounter::available()) {
+        std::fprintf(stderr, "allocation counting needs glibc allocator interposition, skipping\n");
+        return 0;
+    }
+
+    QFile file(path);
+    if (! file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::fprintf(stderr, "edhclient_bench: unable to read budgets from %s\n", qPrintable(path));
+        return 1;
+    }
+
+    QHash<QString, double> budgets;
+    QTextStream in(&file);
+    while (! in.atEnd()) {
+        QStringList fields = in.readLine().simplified().split(' ');
+        if (fields.size() == 2 && ! fields[0].startsWith('#')) {
+            budgets.insert(fields[0], fields[1].toDouble());
+        }
+    }
+
+    bool ok = true;
+    for (const auto& measured : measure()) {
+        if (! budgets.contains(measured.name)) {
+            std::printf("%-28s %8.2f allocs/msg  no budget, recalibrate\n", qPrintable(measured.name), measured.measured);
+            ok = false;
+            continue;
+        }
+
+        double budget = budgets.value(measured.name);
+        bool within = measured.measured <= budget;
+        std::printf("%-28s %8.2f allocs/msg  budget %8.2f  %s\n", qPrintable(measured.name), measured.measured, budget, within ? "ok" : "OVER BUDGET");
+        ok = within && ok;
+    }
+    return ok ? 0 : 1;
+}
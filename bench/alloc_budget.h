@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QString>
+
+namespace AllocBudget {
+    /*
+     * Budgets for the steady-state hot paths, in heap allocations per message.
+     *
+     * The budgets live in a file written by calibrate(): the allocations measured on each path
+     * plus Margin, rounded up. Recalibrate whenever a path gets cheaper so the gain cannot
+     * silently regress, and after a Qt upgrade.
+     */
+    const double Margin = 0.25;
+
+    // measures the paths and writes their budgets to path, returns the process exit code
+    int calibrate(const QString& path);
+    // returns the process exit code: 0 within the budgets read from path, 1 otherwise
+    int check(const QString& path);
+}
@@ -0,0 +1,64 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<quint64> allocations{0};
+
+#if defined(__GLIBC__)
+/*
+ * Qt containers allocate through malloc rather than operator new, so on glibc
+ * the allocator entry points themselves are interposed. operator new ends up
+ * in malloc and is counted through it.
+ */
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+
+    void* malloc(size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+}
+
+bool AllocCounter::available() {
+    return true;
+}
+#else
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+// without allocator interposition only operator new is seen, Qt containers are not
+bool AllocCounter::available() {
+    return false;
+}
+#endif
+
+quint64 AllocCounter::count() {
+    return allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace AllocCounter {
+    // heap allocations (malloc, calloc, realloc and operator new) made by this process
+    quint64 count();
+    bool available();
+}
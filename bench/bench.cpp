@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "alloc_counter.h"
+
+#include <cstdio>
+
+#include <QElapsedTimer>
+
+Bench::Bench(const QString &filter, qint64 minTimeMs) :
+    _filter(filter),
+    _minTimeMs(minTimeMs)
+{}
+
+void Bench::run(const QString &name, quint64 ops, const std::function<void()> &fn) {
+    if (! _filter.isEmpty() && ! name.contains(_filter)) {
+        return;
+    }
+
+    // warm up caches, lazily built tables and Qt's shared nulls
+    for (int i = 0; i < 3; i++) {
+        fn();
+    }
+
+    QElapsedTimer timer;
+    quint64 iterations = 0;
+    quint64 allocations = AllocCounter::count();
+    timer.start();
+    do {
+        fn();
+        iterations++;
+    } while (timer.elapsed() < _minTimeMs);
+    qint64 elapsed = timer.nsecsElapsed();
+    allocations = AllocCounter::count() - allocations;
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations * ops;
+    result.nsPerOp = double(elapsed) / result.iterations;
+    result.opsPerSecond = 1e9 / result.nsPerOp;
+    result.allocsPerOp = double(allocations) / result.iterations;
+    _results.append(result);
+
+    std::printf("%-40s %12.1f ns/op %14.0f ops/s %10.2f allocs/op\n",
+                qPrintable(result.name), result.nsPerOp, result.opsPerSecond, result.allocsPerOp);
+    std::fflush(stdout);
+}
+
+void Bench::printHeader() {
+    std::printf("%-40s %15s %17s %16s\n", "benchmark", "ns/op", "ops/s", "allocs/op");
+}
+
+static volatile double benchSink;
+
+void Bench::doNotOptimize(double value) {
+    benchSink = value;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <functional>
+
+struct BenchResult {
+    QString name;
+    quint64 iterations = 0;
+    double nsPerOp = 0;
+    double opsPerSecond = 0;
+    double allocsPerOp = 0;
+};
+
+class Bench {
+public:
+    Bench(const QString& filter, qint64 minTimeMs);
+
+    // fn runs one operation; ops is how many logical operations it counts as
+    void run(const QString& name, quint64 ops, const std::function<void()>& fn);
+
+    const QVector<BenchResult>& results() const { return _results; }
+    static void printHeader();
+    // keeps a result alive so the work producing it is not optimised away
+    static void doNotOptimize(double value);
+private:
+    QString _filter;
+    qint64 _minTimeMs;
+    QVector<BenchResult> _results;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "edhclient.h"
+
+// A Client without a transport, lines are fed straight into handle()
+class BenchClient : public eDrillingHub::Client {
+public:
+    using Client::handle;
+    using Client::handleDownload;
+
+    void open() {}
+    void close() {}
+    void setIgnoreSslErrors(bool) {}
+    QString errorString() { return QString(); }
+    void write(const QString&) {}
+    void writeBinary(const QByteArray&) {}
+};
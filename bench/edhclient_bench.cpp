@@ -0,0 +1,353 @@
+#include <QFile>
+#include <QBuffer>
+#include <QDataStream>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include "edhclient.h"
+#include "serialization.h"
+#include "edhcapture.h"
+#include "edhkernels.h"
+#include "edhbitmatrix.h"
+#include "edhencoder.h"
+#include "edhcatalog.h"
+
+#include "bench.h"
+#include "traffic.h"
+#include "benchclient.h"
+#include "alloc_budget.h"
+
+using namespace eDrillingHub;
+
+static void benchClient(Bench& bench, Traffic& traffic) {
+    BenchClient client;
+    // a connected receiver makes the signal emission part of the measurement
+    QObject::connect(&client, &Client::tagValueUpdated, [](const QString&, const QDateTime&, QMetaType::Type, const QVariant&) {});
+    QObject::connect(&client, &Client::tagRead, [](const QString&, const ReadTagHolder&) {});
+
+    QStringList subscriptions = traffic.subscriptionLines(1000, 10000);
+    bench.run("handle/subscription_scalar", quint64(subscriptions.size()), [&] {
+        for (const auto& line : subscriptions) {
+            client.handle(line);
+        }
+    });
+
+    QStringList browse = traffic.browseLines(10000);
+    bench.run("handle/browse", quint64(browse.size()), [&] {
+        for (const auto& line : browse) {
+            client.handle(line);
+        }
+    });
+
+    QStringList range = traffic.rangeReadLines(traffic.tagName(1), 10000);
+    bench.run("handle/range_read", quint64(range.size()), [&] {
+        for (const auto& line : range) {
+            client.handle(line);
+        }
+    });
+
+    QString vectorLine = QString("subscription|value|%1|1546300800000|%2|%3")
+            .arg(traffic.tagName(2)).arg(int(QMetaType::User)).arg(traffic.vectorValue(1000));
+    bench.run("handle/subscription_vector_1000", 1, [&] {
+        client.handle(vectorLine);
+    });
+}
+
+static void benchSerialization(Bench& bench, Traffic& traffic) {
+    QStringList doubles;
+    for (int i = 0; i < 1000; i++) {
+        doubles.append(QString::number(i * 1.25 - 300, 'g', 10));
+    }
+    bench.run("deserialize/scalar_double", quint64(doubles.size()), [&] {
+        for (const auto& d : doubles) {
+            Serialization::deserializeTagValue(QMetaType::Double, d);
+        }
+    });
+
+    QString escaped = "line one\\r\\nline\\|two with a \\\\ backslash";
+    bench.run("deserialize/scalar_string_escaped", 1, [&] {
+        Serialization::deserializeTagValue(QMetaType::QString, escaped);
+    });
+
+    QString vector = traffic.vectorValue(10000);
+    bench.run("deserialize/vector_double_10000", 1, [&] {
+        Serialization::deserializeTagValue(QMetaType::User, vector);
+    });
+
+    QString matrix = traffic.matrixValue(100, 100);
+    bench.run("deserialize/matrix_double_100x100", 1, [&] {
+        Serialization::deserializeTagValue(QMetaType::User, matrix);
+    });
+
+    QVariant scalar(3.14159);
+    bench.run("serialize/scalar_double", 1, [&] {
+        Serialization::serialize(scalar);
+    });
+
+    QVariant string(QString("a|b\r\nc\\d"));
+    bench.run("serialize/scalar_string", 1, [&] {
+        Serialization::serialize(string);
+    });
+
+    QVariant matrixValue = QVariant::fromValue(traffic.matrix(100, 100));
+    bench.run("serialize/matrix_double_100x100", 1, [&] {
+        Serialization::serialize(matrixValue);
+    });
+
+    QDateTime ts = QDateTime::fromMSecsSinceEpoch(1546300800000, Qt::UTC);
+    bench.run("protocol/write_tag_double", 1, [&] {
+        Protocol::WriteTag(traffic.tagName(3), ts, scalar);
+    });
+
+    CommandEncoder encoder;
+    QString tag = traffic.tagName(3);
+    bench.run("protocol/encode_write_tag_double", 1, [&] {
+        encoder.clear();
+        encoder.writeTag(tag, ts, scalar);
+    });
+
+    bench.run("protocol/encode_subscribe_1000", 1000, [&] {
+        encoder.clear();
+        for (int i = 0; i < 1000; i++) {
+            encoder.subscribeTag(tag);
+        }
+    });
+}
+
+static void benchMatrix(Bench& bench, Traffic& traffic) {
+    Matrix<double> matrix = traffic.matrix(500, 500);
+
+    QByteArray bytes;
+    bench.run("matrix/datastream_write_500x500", 1, [&] {
+        bytes.clear();
+        QDataStream s(&bytes, QIODevice::WriteOnly);
+        s << matrix;
+    });
+
+    bench.run("matrix/datastream_read_500x500", 1, [&] {
+        QDataStream s(bytes);
+        Matrix<double> m;
+        s >> m;
+    });
+
+    bench.run("matrix/append_columns_500x500", 1, [&] {
+        Matrix<double> m = matrix;
+        m.appendColumns(600, 0.0);
+    });
+
+    bench.run("matrix/reshape_500x500_to_400x600", 1, [&] {
+        Matrix<double> m = matrix;
+        m.reshape(400, 600, 0.0);
+    });
+
+    bench.run("matrix/column_view_sum_500x500", 500, [&] {
+        double sum = 0;
+        for (qint32 c = 0; c < matrix.columns(); c++) {
+            MatrixView<const double> column = matrix.column(c);
+            for (qint32 r = 0; r < column.rows(); r++) {
+                sum += column(r, 0);
+            }
+        }
+        Bench::doNotOptimize(sum);
+    });
+}
+
+static void benchKernels(Bench& bench, Traffic& traffic) {
+    Matrix<double> matrix = traffic.matrix(1000, 64);
+    const qint64 elements = qint64(matrix.rows()) * matrix.columns();
+
+    bench.run("kernels/column_stats_scalar_1000x64", elements, [&] {
+        double sum = 0;
+        for (qint32 c = 0; c < matrix.columns(); c++) {
+            double min = matrix(0, c), max = min, total = 0;
+            for (qint32 r = 0; r < matrix.rows(); r++) {
+                min = std::min(min, matrix(r, c));
+                max = std::max(max, matrix(r, c));
+                total += matrix(r, c);
+            }
+            double mean = total / matrix.rows(), squares = 0;
+            for (qint32 r = 0; r < matrix.rows(); r++) {
+                squares += (matrix(r, c) - mean) * (matrix(r, c) - mean);
+            }
+            sum += min + max + std::sqrt(squares / matrix.rows());
+        }
+        Bench::doNotOptimize(sum);
+    });
+
+    bench.run("kernels/column_stats_1000x64", elements, [&] {
+        Bench::doNotOptimize(Kernels::columnStats(matrix).last().stddev);
+    });
+
+    bench.run("kernels/row_stats_1000x64", elements, [&] {
+        Bench::doNotOptimize(Kernels::rowStats(matrix).last().stddev);
+    });
+
+    bench.run("kernels/transpose_1000x64", elements, [&] {
+        Bench::doNotOptimize(Kernels::transpose(matrix)(0, 0));
+    });
+
+    AlignedBuffer<double> out(elements);
+    bench.run("kernels/multiply_64000", elements, [&] {
+        Kernels::multiply(matrix.constData(), matrix.constData(), out.data(), elements);
+        Bench::doNotOptimize(out[0]);
+    });
+}
+
+static void benchBits(Bench& bench) {
+    BitMatrix bits(200, 200);
+    for (qint32 r = 0; r < bits.rows(); r++) {
+        for (qint32 c = r % 3; c < bits.columns(); c += 3) {
+            bits.setBit(r, c);
+        }
+    }
+    QString text = std::get<0>(Serialization::serialize(QVariant::fromValue(bits)));
+    Matrix<bool> bools = bits.toMatrix();
+
+    bench.run("bits/decode_matrix_bool_200x200", 1, [&] {
+        Serialization::deserializeTagValue(QMetaType::User, text);
+    });
+
+    bench.run("bits/decode_bitmatrix_200x200", 1, [&] {
+        bool ok;
+        Serialization::deserializeBitMatrix(text, ok);
+    });
+
+    bench.run("bits/row_counts_matrix_bool_200x200", 1, [&] {
+        qint32 total = 0;
+        for (qint32 r = 0; r < bools.rows(); r++) {
+            for (qint32 c = 0; c < bools.columns(); c++) {
+                total += bools(r, c);
+            }
+        }
+        Bench::doNotOptimize(total);
+    });
+
+    bench.run("bits/row_counts_bitmatrix_200x200", 1, [&] {
+        Bench::doNotOptimize(bits.rowCounts().last());
+    });
+}
+
+static void benchCatalog(Bench& bench, Traffic& traffic) {
+    QStringList names;
+    for (int i = 0; i < 100000; i++) {
+        names.append(traffic.tagName(i));
+    }
+
+    bench.run("catalog/import_100k", 100000, [&] {
+        TagCatalog catalog;
+        for (const auto& name : names) {
+            catalog.update(name, QMetaType::Double, QStringLiteral("m"), Tag::Quality::Value::GOOD);
+        }
+        Bench::doNotOptimize(catalog.withPrefix(QStringLiteral("rig1/")).size());
+    });
+
+    TagCatalog catalog;
+    for (const auto& name : names) {
+        catalog.update(name, QMetaType::Double, QStringLiteral("m"), Tag::Quality::Value::GOOD);
+    }
+
+    bench.run("catalog/prefix_100k", 1, [&] {
+        Bench::doNotOptimize(catalog.withPrefix(QStringLiteral("rig1/well4/section2/")).size());
+    });
+
+    bench.run("catalog/glob_100k", 1, [&] {
+        Bench::doNotOptimize(catalog.match(QStringLiteral("rig1/well4/*/sensor1*")).size());
+    });
+
+    bench.run("catalog/substring_100k", 1, [&] {
+        Bench::doNotOptimize(catalog.containing(QStringLiteral("sensor777")).size());
+    });
+
+    bench.run("catalog/linear_scan_100k", 1, [&] {
+        int count = 0;
+        for (const auto& name : names) {
+            count += name.contains(QStringLiteral("sensor777"));
+        }
+        Bench::doNotOptimize(count);
+    });
+}
+
+static int runReplay(const QString& path, bool paced, Bench& bench) {
+    QFile file(path);
+    if (! file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "edhclient_bench: unable to open %s\n", qPrintable(path));
+        return 1;
+    }
+
+    QVector<CaptureRecord> records;
+    if (! CaptureReader::read(&file, records)) {
+        return 1;
+    }
+
+    BenchClient client;
+    QObject::connect(&client, &Client::tagValueUpdated, [](const QString&, const QDateTime&, QMetaType::Type, const QVariant&) {});
+    QObject::connect(&client, &Client::tagRead, [](const QString&, const ReadTagHolder&) {});
+
+    CaptureReplay replay(&client, records);
+    if (paced) {
+        QObject::connect(&replay, &CaptureReplay::finished, [&records](qint64 nsecs) {
+            std::printf("replayed %d records in %.3f s at original pacing\n", records.size(), nsecs / 1e9);
+            QCoreApplication::quit();
+        });
+        replay.replayPaced();
+        return QCoreApplication::exec();
+    }
+
+    bench.run("replay/" + QFileInfo(path).fileName(), quint64(records.size()), [&] {
+        replay.replayFast();
+    });
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("edhclient_bench");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("filter", "Only run benchmarks whose name contains filter");
+    QCommandLineOption minTime("min-time", "Minimum run time per benchmark in milliseconds", "ms", "500");
+    parser.addOption(minTime);
+    QCommandLineOption replayFile("replay", "Replay a capture recorded with Client::setCapture instead of the generated traffic", "file");
+    parser.addOption(replayFile);
+    QCommandLineOption paced("paced", "Replay at the original pacing rather than as fast as possible");
+    parser.addOption(paced);
+    QCommandLineOption allocBudget("alloc-budget", "Check the steady-state allocations against the budgets in file and exit non-zero when exceeded", "file");
+    parser.addOption(allocBudget);
+    QCommandLineOption allocCalibrate("alloc-calibrate", "Measure the steady-state allocations and write them with a margin as budgets to file", "file");
+    parser.addOption(allocCalibrate);
+    parser.process(app);
+
+    QString filter = parser.positionalArguments().value(0);
+    Bench bench(filter, parser.value(minTime).toLongLong());
+    Traffic traffic;
+
+    if (parser.isSet(allocCalibrate)) {
+        return AllocBudget::calibrate(parser.value(allocCalibrate));
+    }
+    if (parser.isSet(allocBudget)) {
+        return AllocBudget::check(parser.value(allocBudget));
+    }
+
+    if (parser.isSet(replayFile)) {
+        if (! parser.isSet(paced)) {
+            Bench::printHeader();
+        }
+        return runReplay(parser.value(replayFile), parser.isSet(paced), bench);
+    }
+
+    Bench::printHeader();
+    benchClient(bench, traffic);
+    benchSerialization(bench, traffic);
+    benchMatrix(bench, traffic);
+    benchKernels(bench, traffic);
+    benchBits(bench);
+    benchCatalog(bench, traffic);
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "traffic.h"
+
+#include "serialization.h"
+
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+Traffic::Traffic(quint32 seed) :
+    _rng(seed),
+    _values(-1000.0, 1000.0),
+    _timestamp(1546300800000)
+{}
+
+QString Traffic::tagName(int index) const {
+    return QString("rig%1/well%2/section%3/sensor%4").arg(index % 3).arg(index % 7).arg(index % 11).arg(index);
+}
+
+QStringList Traffic::subscriptionLines(int tags, int count) {
+    QStringList lines;
+    lines.reserve(count);
+    for (int i = 0; i < count; i++) {
+        _timestamp += 1000 / std::max(tags, 1) + 1;
+        lines.append(QString("subscription|value|%1|%2|%3|%4")
+                     .arg(tagName(i % tags))
+                     .arg(_timestamp)
+                     .arg(int(QMetaType::Double))
+                     .arg(_values(_rng), 0, 'g', 10));
+    }
+    return lines;
+}
+
+QStringList Traffic::browseLines(int tags) {
+    static const char* units[] = {"m", "bar", "rpm", "kN", "degC", "m/h"};
+
+    QStringList lines;
+    lines.reserve(tags + 1);
+    for (int i = 0; i < tags; i++) {
+        lines.append(QString("browse|%1|%2|%3|%4|%5|GOOD")
+                     .arg(tagName(i))
+                     .arg(_timestamp + i)
+                     .arg(int(QMetaType::Double))
+                     .arg(_values(_rng), 0, 'g', 10)
+                     .arg(units[i % 6]));
+    }
+    lines.append("browse|end");
+    return lines;
+}
+
+QStringList Traffic::rangeReadLines(const QString &tag, int samples) {
+    QStringList lines;
+    lines.reserve(samples + 2);
+
+    qint64 from = _timestamp;
+    lines.append(QString("readStart|%1|%2|%3").arg(tag).arg(from).arg(from + samples * 1000));
+    for (int i = 0; i < samples; i++) {
+        lines.append(QString("read|%1|%2|%3|%4|m|GOOD")
+                     .arg(tag)
+                     .arg(from + i * 1000)
+                     .arg(int(QMetaType::Double))
+                     .arg(_values(_rng), 0, 'g', 10));
+    }
+    lines.append(QString("readEnd|%1").arg(tag));
+    return lines;
+}
+
+QVector<double> Traffic::vector(int length) {
+    QVector<double> v;
+    v.reserve(length);
+    for (int i = 0; i < length; i++) {
+        v.append(_values(_rng));
+    }
+    return v;
+}
+
+Matrix<double> Traffic::matrix(int rows, int columns) {
+    return Matrix<double>(vector(rows * columns), rows, columns);
+}
+
+QString Traffic::vectorValue(int length) {
+    return std::get<0>(Serialization::serialize(QVariant::fromValue(vector(length))));
+}
+
+QString Traffic::matrixValue(int rows, int columns) {
+    return std::get<0>(Serialization::serialize(QVariant::fromValue(matrix(rows, columns))));
+}
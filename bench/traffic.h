@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <random>
+
+#include "edhmatrix.h"
+
+/**
+ * @brief Traffic - deterministic generator of server lines shaped like rig traffic
+ *
+ * The same seed always produces the same lines, so runs are comparable.
+ */
+class Traffic {
+public:
+    explicit Traffic(quint32 seed = 4711);
+
+    QString tagName(int index) const;
+
+    QStringList subscriptionLines(int tags, int count);
+    QStringList browseLines(int tags);
+    QStringList rangeReadLines(const QString& tag, int samples);
+    QString vectorValue(int length);
+    QString matrixValue(int rows, int columns);
+
+    eDrillingHub::Matrix<double> matrix(int rows, int columns);
+    QVector<double> vector(int length);
+private:
+    std::mt19937 _rng;
+    std::uniform_real_distribution<double> _values;
+    qint64 _timestamp;
+};
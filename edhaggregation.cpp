@@ -0,0 +1,220 @@
+#include "edhaggregation.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+RangeAggregator::RangeAggregator(const Aggregation &aggregation, qint64 from, qint64 to) :
+    _aggregation(aggregation),
+    _from(from),
+    _to(to)
+{
+    if (_aggregation.buckets < 1) {
+        _aggregation.buckets = 1;
+    }
+    if (_aggregation.mode != Aggregation::Mode::LTTB) {
+        _buckets.resize(_aggregation.buckets);
+    }
+}
+
+int RangeAggregator::bucket(qint64 timestamp) const {
+    qint64 span = _to - _from + 1;
+    if (span <= 0 || timestamp <= _from) {
+        return 0;
+    }
+
+    int idx = static_cast<int>(double(timestamp - _from) * _aggregation.buckets / double(span));
+    return std::min(idx, _aggregation.buckets - 1);
+}
+
+qint64 RangeAggregator::bucketStart(int bucket) const {
+    qint64 span = _to - _from + 1;
+    return _from + static_cast<qint64>(double(span) * bucket / _aggregation.buckets);
+}
+
+void RangeAggregator::add(qint64 timestamp, QMetaType::Type type, const QString &value) {
+    bool ok = true;
+    double v = 0;
+
+    switch (type) {
+    case QMetaType::Double:
+        v = value.toDouble(&ok);
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::QDateTime:
+        v = static_cast<double>(value.toLongLong(&ok));
+        break;
+    case QMetaType::Bool:
+        v = value.compare(QStringLiteral("true"), Qt::CaseInsensitive) == 0 ? 1 : 0;
+        break;
+    default:
+        ok = false;
+        break;
+    }
+
+    if (! ok && _aggregation.mode != Aggregation::Mode::Count) {
+        return;
+    }
+
+    add(timestamp, v);
+}
+
+void RangeAggregator::add(qint64 timestamp, double value) {
+    _count++;
+
+    if (_aggregation.mode == Aggregation::Mode::LTTB) {
+        addLttb(timestamp, value);
+        return;
+    }
+
+    Bucket& b = _buckets[bucket(timestamp)];
+    if (b.count == 0) {
+        b.min = b.max = b.first = b.last = value;
+        b.minTs = b.maxTs = b.firstTs = b.lastTs = timestamp;
+    } else {
+        if (value < b.min) {
+            b.min = value;
+            b.minTs = timestamp;
+        }
+        if (value > b.max) {
+            b.max = value;
+            b.maxTs = timestamp;
+        }
+        if (timestamp < b.firstTs) {
+            b.first = value;
+            b.firstTs = timestamp;
+        }
+        if (timestamp >= b.lastTs) {
+            b.last = value;
+            b.lastTs = timestamp;
+        }
+    }
+    b.count++;
+    b.sum += value;
+}
+
+void RangeAggregator::addLttb(qint64 timestamp, double value) {
+    if (_selected.isEmpty() && _current.isEmpty()) {
+        _anchor = Point{timestamp, value};
+        _selected.append(_anchor);
+        return;
+    }
+
+    int b = bucket(timestamp);
+    if (b != _currentBucket) {
+        if (! _current.isEmpty()) {
+            completeLttbBucket();
+        }
+        _currentBucket = b;
+    }
+    _current.append(Point{timestamp, value});
+}
+
+void RangeAggregator::completeLttbBucket() {
+    if (! _held.isEmpty()) {
+        double ts = 0, value = 0;
+        for (const auto& p : _current) {
+            ts += p.ts;
+            value += p.value;
+        }
+        Point average{static_cast<qint64>(ts / _current.size()), value / _current.size()};
+
+        _anchor = selectLttb(_held, average);
+        _selected.append(_anchor);
+    }
+
+    _held.swap(_current);
+    _current.clear();
+}
+
+RangeAggregator::Point RangeAggregator::selectLttb(const QVector<Point> &points, const Point &next) const {
+    Point best = points.first();
+    double bestArea = -1;
+
+    for (const auto& p : points) {
+        double area = std::abs(double(_anchor.ts - next.ts) * (p.value - _anchor.value) -
+                               double(_anchor.ts - p.ts) * (next.value - _anchor.value));
+        if (area > bestArea) {
+            bestArea = area;
+            best = p;
+        }
+    }
+
+    return best;
+}
+
+void RangeAggregator::finish(ReadTagHolder &holder) {
+    holder.timestamps.clear();
+    holder.values.clear();
+
+    auto append = [&holder](qint64 ts, const QVariant& value) {
+        holder.timestamps.append(QDateTime::fromMSecsSinceEpoch(ts, Qt::UTC));
+        holder.values.append(value);
+    };
+
+    if (_aggregation.mode == Aggregation::Mode::LTTB) {
+        if (! _held.isEmpty()) {
+            if (! _current.isEmpty()) {
+                _anchor = selectLttb(_held, _current.last());
+            } else {
+                _anchor = _held.last();
+            }
+            _selected.append(_anchor);
+        }
+        if (! _current.isEmpty()) {
+            _selected.append(_current.last());
+        }
+
+        holder.timestamps.reserve(_selected.size());
+        holder.values.reserve(_selected.size());
+        for (const auto& p : _selected) {
+            append(p.ts, p.value);
+        }
+        return;
+    }
+
+    holder.timestamps.reserve(_buckets.size());
+    holder.values.reserve(_buckets.size());
+    for (int i = 0; i < _buckets.size(); i++) {
+        const Bucket& b = _buckets[i];
+        if (b.count == 0) {
+            continue;
+        }
+
+        switch (_aggregation.mode) {
+        case Aggregation::Mode::Min:
+            append(b.minTs, b.min);
+            break;
+        case Aggregation::Mode::Max:
+            append(b.maxTs, b.max);
+            break;
+        case Aggregation::Mode::First:
+            append(b.firstTs, b.first);
+            break;
+        case Aggregation::Mode::Last:
+            append(b.lastTs, b.last);
+            break;
+        case Aggregation::Mode::Mean:
+            append(bucketStart(i), b.sum / b.count);
+            break;
+        case Aggregation::Mode::Count:
+            append(bucketStart(i), b.count);
+            break;
+        case Aggregation::Mode::MinMax:
+            if (b.minTs == b.maxTs) {
+                append(b.minTs, b.min);
+            } else if (b.minTs < b.maxTs) {
+                append(b.minTs, b.min);
+                append(b.maxTs, b.max);
+            } else {
+                append(b.maxTs, b.max);
+                append(b.minTs, b.min);
+            }
+            break;
+        case Aggregation::Mode::LTTB:
+            break;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QVector>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+
+namespace eDrillingHub {
+    struct Aggregation {
+        enum class Mode {
+            Min,
+            Max,
+            First,
+            Last,
+            Mean,
+            Count,
+            MinMax,
+            LTTB
+        };
+
+        Mode mode = Mode::MinMax;
+        int buckets = 0;
+    };
+
+    /**
+     * @brief RangeAggregator - folds a range read into time buckets as the samples arrive
+     *
+     * The interval [from, to] is split into equally long buckets. Min, Max, First and Last
+     * report the selected sample, Mean and Count report at the start of the bucket, and
+     * MinMax reports both extremes of a bucket in time order. LTTB (largest triangle three
+     * buckets) picks one sample per bucket for visual fidelity while only holding the
+     * samples of two buckets at a time. Empty buckets produce no output.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC RangeAggregator {
+    public:
+        RangeAggregator(const Aggregation& aggregation, qint64 from, qint64 to);
+
+        void add(qint64 timestamp, double value);
+        void add(qint64 timestamp, QMetaType::Type type, const QString& value);
+        void finish(ReadTagHolder& holder);
+
+        qint64 count() const { return _count; }
+    private:
+        struct Bucket {
+            qint64 count = 0;
+            double sum = 0;
+            double min = 0, max = 0, first = 0, last = 0;
+            qint64 minTs = 0, maxTs = 0, firstTs = 0, lastTs = 0;
+        };
+
+        struct Point {
+            qint64 ts;
+            double value;
+        };
+
+        int bucket(qint64 timestamp) const;
+        qint64 bucketStart(int bucket) const;
+
+        void addLttb(qint64 timestamp, double value);
+        void completeLttbBucket();
+        Point selectLttb(const QVector<Point>& points, const Point& next) const;
+
+        Aggregation _aggregation;
+        qint64 _from, _to;
+        qint64 _count = 0;
+        QVector<Bucket> _buckets;
+
+        QVector<Point> _held, _current, _selected;
+        int _currentBucket = -1;
+        Point _anchor{0, 0};
+    };
+}
@@ -0,0 +1,323 @@
+#include "edhasync.h"
+#include "edhclient.h"
+#include "edhclient_private.h"
+#include "file_session.h"
+
+#include <QTimer>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+
+#include <algorithm>
+#include <functional>
+
+using namespace eDrillingHub;
+
+namespace eDrillingHub {
+    struct AsyncRequest : PendingReply, std::enable_shared_from_this<AsyncRequest> {
+        AsyncClient* owner = nullptr;
+        QString target;
+        // registers the reply with the client and writes the command
+        std::function<void(const std::shared_ptr<AsyncRequest>&)> send;
+        bool background = false;
+        bool sent = false;
+        bool done = false;
+        // the reply has been consumed, a sent request holds its slot until then
+        bool answered = false;
+
+        bool canceled() const override { return done || futureCanceled(); }
+        void failed(const QString& description) override { fail(AsyncClient::Failure::Server, description); }
+        void aborted() override { fail(AsyncClient::Failure::Disconnected, QString("connection lost")); }
+
+        void released() override {
+            answered = true;
+            if (owner) {
+                owner->released(this);
+            }
+        }
+
+        virtual bool futureCanceled() const = 0;
+        virtual void cancelFuture() = 0;
+        // forwards a cancel() on the future to the owner
+        virtual void watch() = 0;
+
+        void cancel() {
+            if (done) {
+                return;
+            }
+            cancelFuture();
+            complete();
+        }
+
+        void complete() {
+            if (owner) {
+                owner->finished(this);
+            }
+        }
+
+        void fail(AsyncClient::Failure failure, const QString& description) {
+            if (done) {
+                return;
+            }
+            cancelFuture();
+            if (owner) {
+                owner->failed(this, failure, description);
+            }
+        }
+    };
+}
+
+namespace {
+    template <typename T>
+    struct TypedRequest : AsyncRequest {
+        QFutureInterface<T> promise;
+
+        TypedRequest() {
+            promise.reportStarted();
+        }
+
+        bool futureCanceled() const override {
+            return promise.isCanceled();
+        }
+
+        void cancelFuture() override {
+            promise.reportCanceled();
+            promise.reportFinished();
+        }
+
+        void watch() override {
+            auto watcher = new QFutureWatcher<T>(owner);
+            std::weak_ptr<AsyncRequest> weak = shared_from_this();
+            QObject::connect(watcher, &QFutureWatcherBase::canceled, owner, [weak] {
+                if (auto request = weak.lock()) {
+                    request->cancel();
+                }
+            });
+            QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+            watcher->setFuture(promise.future());
+        }
+
+        void resolve(const T& value) {
+            if (done) {
+                return;
+            }
+            promise.reportResult(value);
+            promise.reportFinished();
+            complete();
+        }
+    };
+
+    struct ValueRequest : TypedRequest<TagSample> {
+        void valueRead(const QDateTime& timestamp, QMetaType::Type type, const QVariant& value) override {
+            TagSample sample;
+            sample.timestamp = timestamp;
+            sample.type = type;
+            sample.value = value;
+            resolve(sample);
+        }
+    };
+
+    struct RangeReadRequest : TypedRequest<ReadTagHolder> {
+        void readFinished(const ReadTagHolder& data) override {
+            resolve(data);
+        }
+    };
+
+    struct RangeQueryRequest : TypedRequest<QPair<qint64, qint64>> {
+        void rangeQueried(qint64 start, qint64 end) override {
+            resolve(qMakePair(start, end));
+        }
+    };
+
+    struct DownloadRequest : TypedRequest<QByteArray> {
+        std::shared_ptr<DownloadSession> session;
+        QByteArray data;
+    };
+}
+
+AsyncClient::AsyncClient(Client *client, QObject *parent) :
+    QObject(parent),
+    _client(client)
+{
+}
+
+AsyncClient::~AsyncClient() {
+    // replies still registered with the client find their requests done
+    QList<std::shared_ptr<AsyncRequest>> requests = _waiting + _background + _inFlight;
+    for (const auto& request : requests) {
+        request->owner = nullptr;
+        if (! request->done) {
+            request->done = true;
+            request->cancelFuture();
+        }
+    }
+}
+
+void AsyncClient::setMaxInFlight(int requests) {
+    _maxInFlight = std::max(requests, 1);
+    dispatch();
+}
+
+void AsyncClient::setTimeout(int msecs) {
+    _timeout = std::max(msecs, 0);
+}
+
+QFuture<TagSample> AsyncClient::readTag(const QString &tag) {
+    auto request = std::make_shared<ValueRequest>();
+    request->target = tag;
+    request->send = [this, tag](const std::shared_ptr<AsyncRequest>& self) {
+        self->issued = ++_client->_priv->issued;
+        _client->_priv->valueReads[tag].enqueue(self);
+        _client->write(Protocol::ReadTag(tag));
+    };
+
+    submit(request);
+    return request->promise.future();
+}
+
+QFuture<ReadTagHolder> AsyncClient::readTagRange(const QString &tag, const QDateTime &from, const QDateTime &to, const Aggregation &aggregation, Priority priority) {
+    auto request = std::make_shared<RangeReadRequest>();
+    request->target = tag;
+    request->background = priority == Priority::Background;
+    request->send = [this, tag, from, to, aggregation](const std::shared_ptr<AsyncRequest>& self) {
+        RangeRequest range;
+        range.issued = ++_client->_priv->issued;
+        range.aggregation = aggregation;
+        range.reply = self;
+        _client->_priv->rangeRequests[tag].enqueue(range);
+        _client->write(Protocol::ReadTagRange(tag, from, to));
+    };
+
+    submit(request);
+    return request->promise.future();
+}
+
+QFuture<QPair<qint64, qint64>> AsyncClient::queryTagRange(const QString &tag) {
+    auto request = std::make_shared<RangeQueryRequest>();
+    request->target = tag;
+    request->send = [this, tag](const std::shared_ptr<AsyncRequest>& self) {
+        _client->_priv->rangeQueries[tag].enqueue(self);
+        _client->write(Protocol::QueryTagRange(tag));
+    };
+
+    submit(request);
+    return request->promise.future();
+}
+
+QFuture<QByteArray> AsyncClient::download(const QString &file) {
+    auto request = std::make_shared<DownloadRequest>();
+    request->target = file;
+    request->send = [this, file](const std::shared_ptr<AsyncRequest>& self) {
+        auto request = std::static_pointer_cast<DownloadRequest>(self);
+        std::weak_ptr<DownloadRequest> weak = request;
+        request->session = _client->createDownloadSession();
+
+        // the server streams the whole file regardless, a canceled download just drops it
+        connect(request->session.get(), &DownloadSession::progress, this, [weak](QByteArray bytes, qint64, qint64) {
+            if (auto pending = weak.lock()) {
+                if (pending->canceled()) {
+                    pending->data = QByteArray();
+                } else {
+                    pending->data.append(bytes);
+                }
+            }
+        });
+        connect(request->session.get(), &DownloadSession::success, this, [weak] {
+            if (auto pending = weak.lock()) {
+                QByteArray data;
+                std::swap(data, pending->data);
+                pending->resolve(data);
+                pending->released();
+            }
+        });
+        connect(request->session.get(), &DownloadSession::fail, this, [weak](DownloadSession::FailReason reason, const QString& description) {
+            if (auto pending = weak.lock()) {
+                pending->data = QByteArray();
+                pending->fail(Failure::Server, reason == DownloadSession::FailReason::Hash ? QString("hash mismatch") : description);
+                pending->released();
+            }
+        });
+
+        emit request->session->download(file);
+    };
+
+    submit(request);
+    return request->promise.future();
+}
+
+void AsyncClient::submit(const std::shared_ptr<AsyncRequest> &request) {
+    request->owner = this;
+    request->watch();
+    if (request->background) {
+        _background.enqueue(request);
+    } else {
+        _waiting.enqueue(request);
+    }
+    dispatch();
+}
+
+void AsyncClient::dispatch() {
+    int backgroundLimit = _maxInFlight - 1;
+
+    while (_inFlight.size() < _maxInFlight) {
+        std::shared_ptr<AsyncRequest> request;
+        if (! _waiting.isEmpty()) {
+            request = _waiting.dequeue();
+        } else if (! _background.isEmpty() && _inFlight.size() < backgroundLimit) {
+            request = _background.dequeue();
+        } else {
+            break;
+        }
+        if (request->done) {
+            continue;
+        }
+
+        request->sent = true;
+        _inFlight.append(request);
+        request->send(request);
+
+        if (_timeout > 0) {
+            std::weak_ptr<AsyncRequest> weak = request;
+            int timeout = _timeout;
+            QTimer::singleShot(timeout, this, [this, weak, timeout] {
+                auto pending = weak.lock();
+                if (! pending || pending->done) {
+                    return;
+                }
+                // a late reply is still consumed in order, it is dropped as the request is done
+                pending->fail(Failure::Timeout, QString("no reply within %1 ms").arg(timeout));
+            });
+        }
+    }
+}
+
+void AsyncClient::finished(AsyncRequest *request) {
+    std::shared_ptr<AsyncRequest> keep = request->shared_from_this();
+    request->done = true;
+
+    if (request->sent) {
+        // the slot is freed by released(), the server may still be sending the reply
+        if (! request->answered) {
+            return;
+        }
+        _inFlight.removeOne(keep);
+    } else if (request->background) {
+        _background.removeOne(keep);
+    } else {
+        _waiting.removeOne(keep);
+    }
+    dispatch();
+}
+
+void AsyncClient::released(AsyncRequest *request) {
+    if (! request->done) {
+        return;
+    }
+    _inFlight.removeOne(request->shared_from_this());
+    dispatch();
+}
+
+void AsyncClient::failed(AsyncRequest *request, Failure failure, const QString &description) {
+    QString target = request->target;
+    finished(request);
+    emit requestFailed(target, failure, description);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QObject>
+#include <QFuture>
+#include <QQueue>
+#include <QPair>
+#include <memory>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+#include "edhaggregation.h"
+
+namespace eDrillingHub {
+    class Client;
+    struct AsyncRequest;
+
+    struct TagSample {
+        QDateTime timestamp;
+        QMetaType::Type type = QMetaType::UnknownType;
+        QVariant value;
+    };
+
+    /**
+     * @brief AsyncClient - future-based requests on top of a Client
+     *
+     * Every request returns a QFuture that finishes with the reply, the global signals of the
+     * client are not emitted for it. At most maxInFlight requests are outstanding at a time, the
+     * rest wait in order. Canceling a future drops a waiting request; for a request already sent
+     * the reply is still consumed to keep the stream in step, but its data is no longer buffered,
+     * and the request keeps its slot until the reply has been consumed. Timeouts and disconnects
+     * cancel the future and emit requestFailed, only a disconnect frees the slot of a request
+     * whose reply never arrives.
+     *
+     * Replies are matched to requests per tag in order, so the same tag should not be read
+     * through the client directly while reads issued here are outstanding.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC AsyncClient : public QObject {
+        Q_OBJECT
+    public:
+        enum class Failure {
+            Timeout,
+            Disconnected,
+            Server
+        };
+        Q_ENUM(Failure)
+
+        // background requests only go out while no normal request waits, and leave a slot free,
+        // so with maxInFlight 1 they are never sent
+        enum class Priority {
+            Normal,
+            Background
+        };
+        Q_ENUM(Priority)
+
+        explicit AsyncClient(Client* client, QObject* parent = nullptr);
+        virtual ~AsyncClient();
+
+        void setMaxInFlight(int requests);
+        int maxInFlight() const { return _maxInFlight; }
+        // msecs from sending to the reply, 0 waits forever
+        void setTimeout(int msecs);
+        int timeout() const { return _timeout; }
+
+        Client* client() const { return _client; }
+        int inFlight() const { return _inFlight.size(); }
+        int waiting() const { return _waiting.size() + _background.size(); }
+
+        QFuture<TagSample> readTag(const QString& tag);
+        QFuture<ReadTagHolder> readTagRange(const QString& tag, const QDateTime& from, const QDateTime& to, const Aggregation& aggregation = Aggregation(), Priority priority = Priority::Normal);
+        // first and last timestamp stored for tag
+        QFuture<QPair<qint64, qint64>> queryTagRange(const QString& tag);
+        QFuture<QByteArray> download(const QString& file);
+    signals:
+        void requestFailed(const QString& target, eDrillingHub::AsyncClient::Failure failure, const QString& description);
+
+    private:
+        friend struct AsyncRequest;
+
+        void submit(const std::shared_ptr<AsyncRequest>& request);
+        void dispatch();
+        void finished(AsyncRequest* request);
+        void released(AsyncRequest* request);
+        void failed(AsyncRequest* request, Failure failure, const QString& description);
+
+        Client* _client;
+        int _maxInFlight = 16;
+        int _timeout = 30000;
+
+        QQueue<std::shared_ptr<AsyncRequest>> _waiting;
+        QQueue<std::shared_ptr<AsyncRequest>> _background;
+        QList<std::shared_ptr<AsyncRequest>> _inFlight;
+    };
+}
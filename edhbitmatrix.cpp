@@ -0,0 +1,414 @@
+#include "edhbitmatrix.h"
+
+#include <QDebug>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <limits>
+
+using namespace eDrillingHub;
+
+// the binary stream carries no length, sizes beyond this are taken as corrupt
+static const qint32 bit_max_dimension = 1 << 24;
+
+static qint32 wordsFor(qint32 bits) {
+    return (bits + 63) / 64;
+}
+
+// mask of the bits in use in the last word of a run of bits
+static quint64 tailMask(qint32 bits) {
+    qint32 used = bits & 63;
+    return used == 0 ? ~quint64(0) : (quint64(1) << used) - 1;
+}
+
+static qint32 countWords(const quint64* words, qint32 n) {
+    qint32 count = 0;
+    for (qint32 i = 0; i < n; i++) {
+        count += qPopulationCount(words[i]);
+    }
+    return count;
+}
+
+// reads n words, growing with the data actually present instead of trusting n up front
+static bool readWords(QDataStream& s, qint64 n, QVector<quint64>& words) {
+    if (n > std::numeric_limits<int>::max()) {
+        s.setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+
+    words.reserve(int(std::min<qint64>(n, 4096)));
+    for (qint64 i = 0; i < n; i++) {
+        quint64 word;
+        s >> word;
+        if (s.status() != QDataStream::Ok) {
+            return false;
+        }
+        words.append(word);
+    }
+    return true;
+}
+
+static bool anyWords(const quint64* words, qint32 n) {
+    for (qint32 i = 0; i < n; i++) {
+        if (words[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool allWords(const quint64* words, qint32 n, quint64 lastMask) {
+    if (n == 0) {
+        return true;
+    }
+    for (qint32 i = 0; i < n - 1; i++) {
+        if (words[i] != ~quint64(0)) {
+            return false;
+        }
+    }
+    return words[n - 1] == lastMask;
+}
+
+BitVector::BitVector() :
+    _size(0)
+{
+}
+
+BitVector::BitVector(qint32 size, bool value) :
+    _words(wordsFor(size), value ? ~quint64(0) : 0),
+    _size(size)
+{
+    clearPadding();
+}
+
+BitVector BitVector::fromVector(const QVector<bool> &vector) {
+    BitVector v(vector.size());
+    for (qint32 i = 0; i < vector.size(); i++) {
+        if (vector[i]) {
+            v._words[i >> 6] |= quint64(1) << (i & 63);
+        }
+    }
+    return v;
+}
+
+QVector<bool> BitVector::toVector() const {
+    QVector<bool> vector(_size);
+    for (qint32 i = 0; i < _size; i++) {
+        vector[i] = testBit(i);
+    }
+    return vector;
+}
+
+void BitVector::setBit(qint32 i, bool value) {
+    quint64 bit = quint64(1) << (i & 63);
+    if (value) {
+        _words[i >> 6] |= bit;
+    } else {
+        _words[i >> 6] &= ~bit;
+    }
+}
+
+void BitVector::fill(bool value) {
+    _words.fill(value ? ~quint64(0) : 0);
+    clearPadding();
+}
+
+void BitVector::clearPadding() {
+    if (! _words.isEmpty()) {
+        _words.last() &= tailMask(_size);
+    }
+}
+
+qint32 BitVector::count() const {
+    return countWords(_words.constData(), _words.size());
+}
+
+bool BitVector::any() const {
+    return anyWords(_words.constData(), _words.size());
+}
+
+bool BitVector::all() const {
+    return allWords(_words.constData(), _words.size(), tailMask(_size));
+}
+
+BitVector &BitVector::operator&=(const BitVector &other) {
+    if (_size != other._size) {
+        qWarning() << "BitVector: size mismatch" << _size << other._size;
+        return *this;
+    }
+    for (qint32 i = 0; i < _words.size(); i++) {
+        _words[i] &= other._words[i];
+    }
+    return *this;
+}
+
+BitVector &BitVector::operator|=(const BitVector &other) {
+    if (_size != other._size) {
+        qWarning() << "BitVector: size mismatch" << _size << other._size;
+        return *this;
+    }
+    for (qint32 i = 0; i < _words.size(); i++) {
+        _words[i] |= other._words[i];
+    }
+    return *this;
+}
+
+BitVector &BitVector::operator^=(const BitVector &other) {
+    if (_size != other._size) {
+        qWarning() << "BitVector: size mismatch" << _size << other._size;
+        return *this;
+    }
+    for (qint32 i = 0; i < _words.size(); i++) {
+        _words[i] ^= other._words[i];
+    }
+    return *this;
+}
+
+BitVector BitVector::operator~() const {
+    BitVector v(*this);
+    for (auto& word : v._words) {
+        word = ~word;
+    }
+    v.clearPadding();
+    return v;
+}
+
+bool BitVector::operator==(const BitVector &other) const {
+    return _size == other._size && _words == other._words;
+}
+
+BitMatrix::BitMatrix() :
+    _rows(0),
+    _columns(0),
+    _stride(0)
+{
+}
+
+BitMatrix::BitMatrix(qint32 rows, qint32 columns, bool value) :
+    _rows(rows),
+    _columns(columns),
+    _stride(wordsFor(columns))
+{
+    _words.fill(value ? ~quint64(0) : 0, _rows * _stride);
+    clearPadding();
+}
+
+BitMatrix BitMatrix::fromMatrix(const Matrix<bool> &matrix) {
+    BitMatrix m(matrix.rows(), matrix.columns());
+    const bool* data = matrix.constData();
+    for (qint32 r = 0; r < m._rows; r++) {
+        quint64* words = m._words.data() + r * m._stride;
+        const bool* row = data + r * m._columns;
+        for (qint32 c = 0; c < m._columns; c++) {
+            words[c >> 6] |= quint64(row[c]) << (c & 63);
+        }
+    }
+    return m;
+}
+
+Matrix<bool> BitMatrix::toMatrix() const {
+    Matrix<bool> matrix;
+    matrix.size(_rows, _columns);
+    for (qint32 r = 0; r < _rows; r++) {
+        for (qint32 c = 0; c < _columns; c++) {
+            matrix(r, c) = testBit(r, c);
+        }
+    }
+    return matrix;
+}
+
+bool BitMatrix::testBit(qint32 row, qint32 column) const {
+    return (_words[row * _stride + (column >> 6)] >> (column & 63)) & 1;
+}
+
+void BitMatrix::setBit(qint32 row, qint32 column, bool value) {
+    quint64 bit = quint64(1) << (column & 63);
+    quint64& word = _words[row * _stride + (column >> 6)];
+    if (value) {
+        word |= bit;
+    } else {
+        word &= ~bit;
+    }
+}
+
+void BitMatrix::fill(bool value) {
+    _words.fill(value ? ~quint64(0) : 0);
+    clearPadding();
+}
+
+quint64 BitMatrix::lastWordMask() const {
+    return tailMask(_columns);
+}
+
+void BitMatrix::clearPadding() {
+    if (_stride == 0) {
+        return;
+    }
+    quint64 mask = lastWordMask();
+    for (qint32 r = 0; r < _rows; r++) {
+        _words[r * _stride + _stride - 1] &= mask;
+    }
+}
+
+bool BitMatrix::sameShape(const BitMatrix &other) const {
+    if (_rows != other._rows || _columns != other._columns) {
+        qWarning() << "BitMatrix: dimensions differ" << _rows << "x" << _columns << "and" << other._rows << "x" << other._columns;
+        return false;
+    }
+    return true;
+}
+
+qint32 BitMatrix::count() const {
+    return countWords(_words.constData(), _words.size());
+}
+
+qint32 BitMatrix::countRow(qint32 row) const {
+    return countWords(rowWords(row), _stride);
+}
+
+bool BitMatrix::anyRow(qint32 row) const {
+    return anyWords(rowWords(row), _stride);
+}
+
+bool BitMatrix::allRow(qint32 row) const {
+    return allWords(rowWords(row), _stride, lastWordMask());
+}
+
+BitVector BitMatrix::row(qint32 row) const {
+    BitVector v(_columns);
+    std::copy(rowWords(row), rowWords(row) + _stride, v._words.begin());
+    return v;
+}
+
+QVector<qint32> BitMatrix::rowCounts() const {
+    QVector<qint32> counts(_rows);
+    for (qint32 r = 0; r < _rows; r++) {
+        counts[r] = countRow(r);
+    }
+    return counts;
+}
+
+BitVector BitMatrix::anyRows() const {
+    BitVector v(_rows);
+    for (qint32 r = 0; r < _rows; r++) {
+        v.setBit(r, anyRow(r));
+    }
+    return v;
+}
+
+BitVector BitMatrix::allRows() const {
+    BitVector v(_rows);
+    for (qint32 r = 0; r < _rows; r++) {
+        v.setBit(r, allRow(r));
+    }
+    return v;
+}
+
+BitMatrix &BitMatrix::operator&=(const BitMatrix &other) {
+    if (sameShape(other)) {
+        for (qint32 i = 0; i < _words.size(); i++) {
+            _words[i] &= other._words[i];
+        }
+    }
+    return *this;
+}
+
+BitMatrix &BitMatrix::operator|=(const BitMatrix &other) {
+    if (sameShape(other)) {
+        for (qint32 i = 0; i < _words.size(); i++) {
+            _words[i] |= other._words[i];
+        }
+    }
+    return *this;
+}
+
+BitMatrix &BitMatrix::operator^=(const BitMatrix &other) {
+    if (sameShape(other)) {
+        for (qint32 i = 0; i < _words.size(); i++) {
+            _words[i] ^= other._words[i];
+        }
+    }
+    return *this;
+}
+
+BitMatrix BitMatrix::operator~() const {
+    BitMatrix m(*this);
+    for (auto& word : m._words) {
+        word = ~word;
+    }
+    m.clearPadding();
+    return m;
+}
+
+bool BitMatrix::operator==(const BitMatrix &other) const {
+    return _rows == other._rows && _columns == other._columns && _words == other._words;
+}
+
+QDataStream &operator>>(QDataStream &s, BitVector &v) {
+    qint32 size;
+    s >> size;
+
+    v = BitVector();
+    if (s.status() != QDataStream::Ok) {
+        return s;
+    }
+    if (size < 0) {
+        s.setStatus(QDataStream::ReadCorruptData);
+        return s;
+    }
+
+    QVector<quint64> words;
+    if (! readWords(s, (qint64(size) + 63) / 64, words)) {
+        return s;
+    }
+    v._words = words;
+    v._size = size;
+    v.clearPadding();
+    return s;
+}
+
+QDataStream &operator<<(QDataStream &s, const BitVector &v) {
+    s << v.size();
+    for (qint32 i = 0; i < v.wordCount(); i++) {
+        s << v.words()[i];
+    }
+    return s;
+}
+
+QDataStream &operator>>(QDataStream &s, BitMatrix &m) {
+    qint32 rows, columns;
+    s >> rows;
+    s >> columns;
+
+    m = BitMatrix();
+    if (s.status() != QDataStream::Ok) {
+        return s;
+    }
+    if (rows < 0 || columns < 0 || rows > bit_max_dimension || columns > bit_max_dimension) {
+        s.setStatus(QDataStream::ReadCorruptData);
+        return s;
+    }
+
+    QVector<quint64> words;
+    if (! readWords(s, qint64(rows) * wordsFor(columns), words)) {
+        return s;
+    }
+    m._words = words;
+    m._rows = rows;
+    m._columns = columns;
+    m._stride = wordsFor(columns);
+    m.clearPadding();
+    return s;
+}
+
+QDataStream &operator<<(QDataStream &s, const BitMatrix &m) {
+    s << m.rows();
+    s << m.columns();
+    for (qint32 r = 0; r < m.rows(); r++) {
+        const quint64* words = m.rowWords(r);
+        for (qint32 i = 0; i < m.wordsPerRow(); i++) {
+            s << words[i];
+        }
+    }
+    return s;
+}
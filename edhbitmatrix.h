@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QVector>
+#include <QMetaType>
+#include <QDataStream>
+
+#include "edhtypes.h"
+#include "edhmatrix.h"
+
+namespace eDrillingHub {
+    class BitVector;
+    class BitMatrix;
+}
+
+QDataStream& operator>>(QDataStream& s, eDrillingHub::BitVector& v);
+QDataStream& operator<<(QDataStream& s, const eDrillingHub::BitVector& v);
+QDataStream& operator>>(QDataStream& s, eDrillingHub::BitMatrix& m);
+QDataStream& operator<<(QDataStream& s, const eDrillingHub::BitMatrix& m);
+
+namespace eDrillingHub {
+    /**
+     * @brief BitVector - bit-packed vector of booleans
+     *
+     * Bits are stored in 64 bit words, bits past size() are kept zero so counts and
+     * comparisons can work on whole words. Binary operators require equal sizes.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC BitVector {
+    public:
+        BitVector();
+        explicit BitVector(qint32 size, bool value = false);
+
+        static BitVector fromVector(const QVector<bool>& vector);
+        QVector<bool> toVector() const;
+
+        qint32 size() const { return _size; }
+        bool testBit(qint32 i) const { return (_words[i >> 6] >> (i & 63)) & 1; }
+        void setBit(qint32 i, bool value = true);
+        void fill(bool value);
+
+        qint32 count() const;
+        bool any() const;
+        bool all() const;
+
+        BitVector& operator&=(const BitVector& other);
+        BitVector& operator|=(const BitVector& other);
+        BitVector& operator^=(const BitVector& other);
+        BitVector operator~() const;
+        bool operator==(const BitVector& other) const;
+        bool operator!=(const BitVector& other) const { return ! operator==(other); }
+
+        const quint64* words() const { return _words.constData(); }
+        qint32 wordCount() const { return _words.size(); }
+
+    private:
+        friend class BitMatrix;
+        friend QDataStream& ::operator>>(QDataStream& s, BitVector& v);
+
+        void clearPadding();
+
+        QVector<quint64> _words;
+        qint32 _size;
+    };
+
+    /**
+     * @brief BitMatrix - bit-packed row-major matrix of booleans
+     *
+     * Every row starts on a word boundary, so row counts and row tests run word by word.
+     * Matrix<bool> stores a byte per element, a BitMatrix an eighth of that.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC BitMatrix {
+    public:
+        BitMatrix();
+        BitMatrix(qint32 rows, qint32 columns, bool value = false);
+
+        static BitMatrix fromMatrix(const Matrix<bool>& matrix);
+        Matrix<bool> toMatrix() const;
+
+        qint32 rows() const { return _rows; }
+        qint32 columns() const { return _columns; }
+
+        bool testBit(qint32 row, qint32 column) const;
+        void setBit(qint32 row, qint32 column, bool value = true);
+        void fill(bool value);
+
+        qint32 count() const;
+        qint32 countRow(qint32 row) const;
+        bool anyRow(qint32 row) const;
+        bool allRow(qint32 row) const;
+        BitVector row(qint32 row) const;
+
+        // one entry per row
+        QVector<qint32> rowCounts() const;
+        BitVector anyRows() const;
+        BitVector allRows() const;
+
+        BitMatrix& operator&=(const BitMatrix& other);
+        BitMatrix& operator|=(const BitMatrix& other);
+        BitMatrix& operator^=(const BitMatrix& other);
+        BitMatrix operator~() const;
+        bool operator==(const BitMatrix& other) const;
+        bool operator!=(const BitMatrix& other) const { return ! operator==(other); }
+
+        const quint64* rowWords(qint32 row) const { return _words.constData() + row * _stride; }
+        qint32 wordsPerRow() const { return _stride; }
+
+    private:
+        friend QDataStream& ::operator>>(QDataStream& s, BitMatrix& m);
+
+        quint64 lastWordMask() const;
+        void clearPadding();
+        bool sameShape(const BitMatrix& other) const;
+
+        QVector<quint64> _words;
+        qint32 _rows, _columns, _stride;
+    };
+
+    inline BitVector operator&(BitVector a, const BitVector& b) { return a &= b; }
+    inline BitVector operator|(BitVector a, const BitVector& b) { return a |= b; }
+    inline BitVector operator^(BitVector a, const BitVector& b) { return a ^= b; }
+    inline BitMatrix operator&(BitMatrix a, const BitMatrix& b) { return a &= b; }
+    inline BitMatrix operator|(BitMatrix a, const BitMatrix& b) { return a |= b; }
+    inline BitMatrix operator^(BitMatrix a, const BitMatrix& b) { return a ^= b; }
+}
+
+Q_DECLARE_METATYPE(eDrillingHub::BitVector)
+Q_DECLARE_METATYPE(eDrillingHub::BitMatrix)
@@ -0,0 +1,133 @@
+#include "edhcapture.h"
+#include "edhclient.h"
+
+#include <QDebug>
+#include <QDateTime>
+#include <QIODevice>
+#include <QtEndian>
+
+using namespace eDrillingHub;
+
+static const QByteArray capture_magic("EDHCAP01");
+static const int record_header_size = 1 + 8 + 4;
+
+CaptureWriter::CaptureWriter(QIODevice *device) :
+    _device(device)
+{
+    uchar start[8];
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), start);
+
+    _ok = _device->write(capture_magic) == capture_magic.size() &&
+          _device->write(reinterpret_cast<const char*>(start), sizeof(start)) == qint64(sizeof(start));
+    _clock.start();
+}
+
+void CaptureWriter::write(CaptureRecord::Kind kind, const QByteArray &data) {
+    if (! _ok) {
+        return;
+    }
+
+    uchar header[record_header_size];
+    header[0] = static_cast<uchar>(kind);
+    qToLittleEndian<qint64>(_clock.nsecsElapsed(), header + 1);
+    qToLittleEndian<quint32>(quint32(data.size()), header + 9);
+
+    if (_device->write(reinterpret_cast<const char*>(header), record_header_size) != record_header_size ||
+        _device->write(data) != data.size()) {
+        qWarning() << "CaptureWriter: write failed, capture stopped" << _device->errorString();
+        _ok = false;
+    }
+}
+
+bool CaptureReader::read(QIODevice *device, QVector<CaptureRecord> &records, qint64 *startedAt) {
+    QByteArray bytes = device->readAll();
+    if (! bytes.startsWith(capture_magic) || bytes.size() < capture_magic.size() + 8) {
+        qWarning() << "CaptureReader: not a capture file";
+        return false;
+    }
+
+    const uchar* data = reinterpret_cast<const uchar*>(bytes.constData());
+    int pos = capture_magic.size();
+    if (startedAt) {
+        *startedAt = qFromLittleEndian<qint64>(data + pos);
+    }
+    pos += 8;
+
+    while (pos + record_header_size <= bytes.size()) {
+        CaptureRecord record;
+        record.kind = static_cast<CaptureRecord::Kind>(data[pos]);
+        record.timestamp = qFromLittleEndian<qint64>(data + pos + 1);
+        int size = int(qFromLittleEndian<quint32>(data + pos + 9));
+        pos += record_header_size;
+
+        // a capture cut short by a crash ends in a partial record
+        if (size < 0 || pos + size > bytes.size()) {
+            qWarning() << "CaptureReader: truncated record at" << pos;
+            break;
+        }
+
+        record.data = bytes.mid(pos, size);
+        pos += size;
+        records.append(record);
+    }
+
+    return true;
+}
+
+CaptureReplay::CaptureReplay(Client *client, const QVector<CaptureRecord> &records, QObject *parent) :
+    QObject(parent),
+    _client(client),
+    _records(records)
+{
+    _timer.setSingleShot(true);
+    connect(&_timer, &QTimer::timeout, this, &CaptureReplay::next);
+}
+
+void CaptureReplay::feed(const CaptureRecord &record) {
+    if (record.kind == CaptureRecord::Kind::Line) {
+        _client->received();
+        _client->handle(QString::fromUtf8(record.data));
+    } else {
+        _client->handleDownload(record.data);
+    }
+}
+
+qint64 CaptureReplay::replayFast() {
+    QElapsedTimer clock;
+    clock.start();
+
+    for (const auto& record : _records) {
+        feed(record);
+    }
+
+    return clock.nsecsElapsed();
+}
+
+void CaptureReplay::replayPaced() {
+    _position = 0;
+    _clock.start();
+    // from the event loop, so finished() never fires before the caller can wait for it
+    _timer.start(0);
+}
+
+void CaptureReplay::next() {
+    if (_records.isEmpty()) {
+        emit finished(0);
+        return;
+    }
+
+    qint64 base = _records.first().timestamp;
+    while (_position < _records.size()) {
+        const CaptureRecord& record = _records[_position];
+        qint64 due = (record.timestamp - base) - _clock.nsecsElapsed();
+        if (due > 1000000) {
+            _timer.start(int(due / 1000000));
+            return;
+        }
+
+        _position++;
+        feed(record);
+    }
+
+    emit finished(_clock.nsecsElapsed());
+}
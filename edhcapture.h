@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QTimer>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include "edhtypes.h"
+
+class QIODevice;
+
+namespace eDrillingHub {
+    class Client;
+
+    /*
+     * Capture file layout, little endian:
+     *   header: "EDHCAP01", qint64 wall clock at start (ms since epoch)
+     *   record: quint8 kind, qint64 receive time (ns since start), quint32 size, size bytes
+     */
+    struct CaptureRecord {
+        enum class Kind : quint8 {
+            Line = 0,
+            Binary = 1
+        };
+
+        Kind kind;
+        qint64 timestamp;
+        QByteArray data;
+    };
+
+    class EXPORT_LIBEDRILLINGHUB_SPEC CaptureWriter {
+    public:
+        explicit CaptureWriter(QIODevice* device);
+
+        void write(CaptureRecord::Kind kind, const QByteArray& data);
+        bool ok() const { return _ok; }
+    private:
+        QIODevice* _device;
+        QElapsedTimer _clock;
+        bool _ok;
+    };
+
+    class EXPORT_LIBEDRILLINGHUB_SPEC CaptureReader {
+    public:
+        static bool read(QIODevice* device, QVector<CaptureRecord>& records, qint64* startedAt = nullptr);
+    };
+
+    /**
+     * @brief CaptureReplay - feeds a capture back into a client's line and download handling
+     *
+     * Fast replay runs synchronously and returns once every record is handled; paced replay
+     * keeps the original gaps between records and reports through finished().
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC CaptureReplay : public QObject {
+        Q_OBJECT
+    public:
+        CaptureReplay(Client* client, const QVector<CaptureRecord>& records, QObject* parent = nullptr);
+
+        // returns the time spent handling the records, in nanoseconds
+        qint64 replayFast();
+        void replayPaced();
+    signals:
+        void finished(qint64 nsecs);
+    private:
+        void feed(const CaptureRecord& record);
+        void next();
+
+        Client* _client;
+        QVector<CaptureRecord> _records;
+        int _position = 0;
+        QElapsedTimer _clock;
+        QTimer _timer;
+    };
+}
@@ -0,0 +1,204 @@
+#include "edhcatalog.h"
+
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+static bool globMatch(const QChar* name, int nameSize, const QChar* pattern, int patternSize) {
+    int n = 0, p = 0;
+    int starP = -1, starN = 0;
+
+    while (n < nameSize) {
+        if (p < patternSize && pattern[p] == QLatin1Char('*')) {
+            starP = p++;
+            starN = n;
+        } else if (p < patternSize && (pattern[p] == QLatin1Char('?') || pattern[p] == name[n])) {
+            p++;
+            n++;
+        } else if (starP >= 0) {
+            // let the last star swallow one more character
+            p = starP + 1;
+            n = ++starN;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < patternSize && pattern[p] == QLatin1Char('*')) {
+        p++;
+    }
+    return p == patternSize;
+}
+
+void TagCatalog::update(const QString &name, QMetaType::Type type, const QString &unit, Tag::Quality::Value quality) {
+    auto it = _byName.constFind(name);
+    if (it != _byName.constEnd()) {
+        Entry& entry = _entries[it.value()];
+        entry.type = type;
+        entry.unit = unit;
+        entry.quality = quality;
+        return;
+    }
+
+    _byName.insert(name, _entries.size());
+    _entries.append(Entry{name, type, unit, quality});
+    _haystackValid = false;
+}
+
+void TagCatalog::update(const QString &name, QMetaType::Type type) {
+    auto it = _byName.constFind(name);
+    if (it != _byName.constEnd()) {
+        _entries[it.value()].type = type;
+        return;
+    }
+
+    _byName.insert(name, _entries.size());
+    _entries.append(Entry{name, type, QString(), Tag::Quality::Value::DEFAULT});
+    _haystackValid = false;
+}
+
+void TagCatalog::updateUnit(const QString &name, const QString &unit) {
+    auto it = _byName.constFind(name);
+    if (it != _byName.constEnd()) {
+        _entries[it.value()].unit = unit;
+    }
+}
+
+void TagCatalog::updateQuality(const QString &name, Tag::Quality::Value quality) {
+    auto it = _byName.constFind(name);
+    if (it != _byName.constEnd()) {
+        _entries[it.value()].quality = quality;
+    }
+}
+
+void TagCatalog::clear() {
+    _entries.clear();
+    _byName.clear();
+    _order.clear();
+    _haystack.clear();
+    _offsets.clear();
+    _haystackValid = false;
+}
+
+TagCatalog::Entry TagCatalog::value(const QString &name) const {
+    auto it = _byName.constFind(name);
+    return it == _byName.constEnd() ? Entry() : _entries[it.value()];
+}
+
+void TagCatalog::sort() const {
+    int sorted = _order.size();
+    if (sorted == _entries.size()) {
+        return;
+    }
+
+    auto less = [this](int a, int b) {
+        return _entries[a].name < _entries[b].name;
+    };
+
+    _order.reserve(_entries.size());
+    for (int i = sorted; i < _entries.size(); i++) {
+        _order.append(i);
+    }
+    std::sort(_order.begin() + sorted, _order.end(), less);
+    std::inplace_merge(_order.begin(), _order.begin() + sorted, _order.end(), less);
+}
+
+void TagCatalog::buildHaystack() const {
+    if (_haystackValid) {
+        return;
+    }
+    sort();
+
+    int length = 0;
+    for (const auto& entry : _entries) {
+        length += entry.name.size() + 1;
+    }
+
+    _haystack.clear();
+    _haystack.reserve(length);
+    _offsets.resize(0);
+    _offsets.reserve(_order.size());
+    for (int index : _order) {
+        _offsets.append(_haystack.size());
+        _haystack.append(_entries[index].name);
+        _haystack.append(QLatin1Char('\n'));
+    }
+    _haystackValid = true;
+}
+
+int TagCatalog::lowerBound(const QString &prefix) const {
+    auto it = std::lower_bound(_order.constBegin(), _order.constEnd(), prefix, [this](int index, const QString& value) {
+        return _entries[index].name < value;
+    });
+    return int(it - _order.constBegin());
+}
+
+QStringList TagCatalog::names() const {
+    sort();
+
+    QStringList names;
+    names.reserve(_order.size());
+    for (int index : _order) {
+        names.append(_entries[index].name);
+    }
+    return names;
+}
+
+QStringList TagCatalog::withPrefix(const QString &prefix) const {
+    sort();
+
+    QStringList names;
+    for (int i = lowerBound(prefix); i < _order.size(); i++) {
+        const QString& name = _entries[_order[i]].name;
+        if (! name.startsWith(prefix)) {
+            break;
+        }
+        names.append(name);
+    }
+    return names;
+}
+
+QStringList TagCatalog::match(const QString &pattern) const {
+    sort();
+
+    int literal = 0;
+    while (literal < pattern.size() && pattern[literal] != QLatin1Char('*') && pattern[literal] != QLatin1Char('?')) {
+        literal++;
+    }
+    QString prefix = pattern.left(literal);
+    const QChar* rest = pattern.constData() + literal;
+    int restSize = pattern.size() - literal;
+
+    QStringList names;
+    for (int i = lowerBound(prefix); i < _order.size(); i++) {
+        const QString& name = _entries[_order[i]].name;
+        if (! name.startsWith(prefix)) {
+            break;
+        }
+        if (globMatch(name.constData() + literal, name.size() - literal, rest, restSize)) {
+            names.append(name);
+        }
+    }
+    return names;
+}
+
+QStringList TagCatalog::containing(const QString &text, Qt::CaseSensitivity cs) const {
+    if (text.isEmpty()) {
+        return names();
+    }
+    if (text.contains(QLatin1Char('\n'))) {
+        return QStringList();
+    }
+    buildHaystack();
+
+    QStringList names;
+    int from = 0;
+    int hit;
+    while ((hit = _haystack.indexOf(text, from, cs)) >= 0) {
+        // the name holding the hit, searching goes on with the next name
+        int i = int(std::upper_bound(_offsets.constBegin(), _offsets.constEnd(), hit) - _offsets.constBegin()) - 1;
+        names.append(_entries[_order[i]].name);
+        from = i + 1 < _offsets.size() ? _offsets[i + 1] : _haystack.size();
+    }
+    return names;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QMetaType>
+
+#include "edhtypes.h"
+
+namespace eDrillingHub {
+    /**
+     * @brief TagCatalog - the tags known to a client, with their type, unit and quality
+     *
+     * Entries are kept in arrival order with a name hash for updates, queries go through an
+     * index of the entries sorted by name. New names only mark the index stale; the next query
+     * sorts them and merges them in, so importing a browse reply costs one sort. Prefix and glob
+     * queries binary search the literal prefix and scan the matching range only, substring
+     * queries search one buffer holding all names.
+     *
+     * Queries update the index lazily, the catalog is not safe for concurrent use.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC TagCatalog {
+    public:
+        struct Entry {
+            QString name;
+            QMetaType::Type type = QMetaType::UnknownType;
+            QString unit;
+            Tag::Quality::Value quality = Tag::Quality::Value::DEFAULT;
+        };
+
+        void update(const QString& name, QMetaType::Type type, const QString& unit, Tag::Quality::Value quality);
+        // adds name with the default unit and quality, or only changes its type
+        void update(const QString& name, QMetaType::Type type);
+        // unknown names are ignored
+        void updateUnit(const QString& name, const QString& unit);
+        void updateQuality(const QString& name, Tag::Quality::Value quality);
+        void clear();
+
+        int size() const { return _entries.size(); }
+        bool contains(const QString& name) const { return _byName.contains(name); }
+        // a default Entry with an empty name for unknown tags
+        Entry value(const QString& name) const;
+
+        // all results are sorted by name
+        QStringList names() const;
+        QStringList withPrefix(const QString& prefix) const;
+        // '*' matches any sequence including '/', '?' matches one character
+        QStringList match(const QString& pattern) const;
+        QStringList containing(const QString& text, Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+
+    private:
+        void sort() const;
+        void buildHaystack() const;
+        // first position in _order whose name is not less than prefix
+        int lowerBound(const QString& prefix) const;
+
+        QVector<Entry> _entries;
+        QHash<QString, int> _byName;
+
+        mutable QVector<int> _order;
+        mutable QString _haystack;
+        mutable QVector<int> _offsets;
+        mutable bool _haystackValid = false;
+    };
+}
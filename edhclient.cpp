@@ -5,9 +5,11 @@
 #include "edhclient_ws.h"
 
 #include "serialization.h"
+#include "edhencoder.h"
 #include "file_session.h"
 
 #include <iostream>
+#include <algorithm>
 
 #include <QStringList>
 #include <QMetaEnum>
@@ -16,8 +18,9 @@
 
 using namespace eDrillingHub;
 
-static const QRegularExpression _commandSplitter("(?<!\\\\)\\|");
-static const QRegularExpression _hashListSplitter("(?<!\\\\)#");
+// commands per write when subscribing or unsubscribing tag lists
+static const int subscribe_batch_size = 1000;
+
 static QMetaEnum _qualityEnum() {
     static QMetaEnum _enum = QMetaEnum::fromType<Tag::Quality::Value>();
     return _enum;
@@ -27,6 +30,16 @@ Client::Client() {
     qRegisterMetaType<ReadTagHolder>();
     qRegisterMetaType<DownloadSession::FailReason>();
     qRegisterMetaType<UploadSession::FailReason>();
+
+    _priv.reset(new ClientPrivate());
+    _priv->reconnectTimer.setSingleShot(true);
+    _priv->clock.start();
+
+    connect(&_priv->reconnectTimer, &QTimer::timeout, this, [this] {
+        open();
+    });
+    connect(this, &Client::connected, this, &Client::onConnected);
+    connect(this, &Client::disconnected, this, &Client::onDisconnected);
 }
 
 Client::~Client() {
@@ -66,7 +79,6 @@ Client* Client::create(const QUrl& url) {
         return nullptr;
     }
 
-    client->_priv.reset(new ClientPrivate());
     client->_priv->host = host;
     client->_priv->port = static_cast<quint16>(port);
 
@@ -81,6 +93,7 @@ void Client::updateTagValue(const QString &tagName, qint64 timestamp, const QStr
     bool ok;
     QMetaType::Type metaType = static_cast<QMetaType::Type>(type.toInt(&ok));
     if (! ok) {
+        _priv->metrics.add(Metrics::Counter::DroppedUpdates);
         qWarning() << QString("Dropped tagUpdate on %1, unknown metaType '%2'").arg(tagName, type);
         return;
     }
@@ -88,29 +101,97 @@ void Client::updateTagValue(const QString &tagName, qint64 timestamp, const QStr
     QVariant variantValue = Serialization::deserializeTagValue(metaType, value);
     QDateTime dt = QDateTime::fromMSecsSinceEpoch(timestamp);
 
-    emit tagValueUpdated(tagName, dt, metaType, variantValue);
+    deliverTagValue(tagName, dt, metaType, variantValue);
+}
+
+void Client::deliverTagValue(const QString &tagName, const QDateTime &timestamp, QMetaType::Type metaType, const QVariant &variantValue) {
+    if (_priv->autoReconnect) {
+        auto subscription = _priv->subscriptions.find(tagName);
+        if (subscription != _priv->subscriptions.end()) {
+            auto held = _priv->backfilling.find(tagName);
+            if (held != _priv->backfilling.end()) {
+                held.value().append(HeldUpdate{timestamp, metaType, variantValue});
+                return;
+            }
+
+            subscription.value() = std::max(subscription.value(), timestamp.toMSecsSinceEpoch());
+        }
+    }
+
+    if (_priv->latency) {
+        qint64 now = _priv->clock.nsecsElapsed();
+        qint64 receipt = _priv->receivedAtWall + (_priv->handleStarted - _priv->receivedAt) / 1000000;
+        qint64 sampleToReceipt = (receipt + _priv->latency->clockOffset() - timestamp.toMSecsSinceEpoch()) * 1000;
+
+        _priv->latency->record(tagName, metaType,
+                               sampleToReceipt,
+                               (now - _priv->handleStarted) / 1000,
+                               (_priv->handleStarted - _priv->receivedAt) / 1000);
+    }
+
+    if (_priv->liveHistory) {
+        _priv->liveHistory->append(tagName, timestamp.toMSecsSinceEpoch(), metaType, variantValue);
+    }
+
+    _priv->metrics.add(Metrics::Counter::ValueUpdates);
+    emit tagValueUpdated(tagName, timestamp, metaType, variantValue);
 }
 
 void Client::updateTagQuality(const QString &tagName, const QString &quality) {
     bool qOk;
     Tag::Quality::Value edhQuality = static_cast<Tag::Quality::Value>(_qualityEnum().keyToValue(quality.toUtf8(), &qOk));
     if (qOk) {
+        _priv->catalog.updateQuality(tagName, edhQuality);
+        _priv->metrics.add(Metrics::Counter::QualityUpdates);
         emit tagQualityUpdated(tagName, edhQuality);
     }
 }
 
 void Client::updateTagUnit(const QString &tagName, const QString &unit) {
+    _priv->catalog.updateUnit(tagName, unit);
+    _priv->metrics.add(Metrics::Counter::UnitUpdates);
     emit tagUnitUpdated(tagName, unit);
 }
 
 void Client::updateTag(const QString& tagName, qint64 timestamp, const QString& type, const QString& value, const QString& unit, const QString& quality) {
+    bool typeOk;
+    int metaType = type.toInt(&typeOk);
+    // unit and quality reach the catalog through updateTagUnit and updateTagQuality
+    _priv->catalog.update(tagName, typeOk ? static_cast<QMetaType::Type>(metaType) : QMetaType::UnknownType);
+
     updateTagUnit(tagName, unit);
     updateTagQuality(tagName, quality);
     updateTagValue(tagName, timestamp, type, value);
 }
 
+void Client::received() {
+    if (_priv->latency) {
+        _priv->receivedAt = _priv->clock.nsecsElapsed();
+        _priv->receivedAtWall = QDateTime::currentMSecsSinceEpoch();
+    }
+}
+
 void Client::handle(const QString &line) {
-    QStringList splits = line.trimmed().split(_commandSplitter);
+    _priv->handleStarted = _priv->clock.nsecsElapsed();
+    if (_priv->latency && _priv->receivedAtWall == 0) {
+        received();
+    }
+
+    // times the line and samples the container sizes on every way out of handle
+    struct HandleScope {
+        Client* client;
+        Metrics::Command command;
+        ~HandleScope() {
+            client->_priv->metrics.time(command, quint64(client->_priv->clock.nsecsElapsed() - client->_priv->handleStarted));
+            client->updateGauges();
+        }
+    } scope{this, Metrics::Command::Unknown};
+    _priv->metrics.add(Metrics::Counter::LinesReceived);
+    if (_priv->capture) {
+        _priv->capture->write(CaptureRecord::Kind::Line, line.toUtf8());
+    }
+
+    QStringList splits = Serialization::split(line.trimmed(), QLatin1Char('|'));
 
     if (splits.size() == 0) {
         return;
@@ -118,8 +199,19 @@ void Client::handle(const QString &line) {
 
     QString main = splits[0];
     if (main == QStringLiteral("servertime")) {
+        scope.command = Metrics::Command::ServerTime;
+        if (splits.size() < 2) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
+            qWarning() << "Invalid servertime from server";
+            return;
+        }
 
+        if (_priv->latency) {
+            qint64 local = _priv->receivedAtWall + (_priv->handleStarted - _priv->receivedAt) / 1000000;
+            _priv->latency->recordServerTime(splits[1].toLongLong(), local);
+        }
     } else if (main == QStringLiteral("browse")) {
+        scope.command = Metrics::Command::Browse;
         if (splits.size() == 1) {
             return;
         }
@@ -142,7 +234,9 @@ void Client::handle(const QString &line) {
 
         updateTag(tagName, timestamp, type, value, unit, quality);
     } else if (main == QStringLiteral("subscription")) {
+        scope.command = Metrics::Command::Subscription;
         if (splits.size() < 4) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Invalid subscription from server";
             return;
         }
@@ -151,6 +245,7 @@ void Client::handle(const QString &line) {
         QString tagName = splits[2];
         if (updateType == QStringLiteral("value")) {
             if (splits.size() < 6) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Invalid value-subscription from server";
                 return;
             }
@@ -167,15 +262,18 @@ void Client::handle(const QString &line) {
             QString unit = splits[3];
             updateTagUnit(tagName, unit);
         } else {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown subscription from server" << updateType;
             return;
         }
     } else if (main == QStringLiteral("read")) {
+        scope.command = Metrics::Command::Read;
         if (splits.size() < 7) {
-            QString command = splits[2];
+            QString command = splits.value(2);
             if (command == QString("queued")) {
                 // ignore, server is just polite
-            } else {
+            } else if (splits.size() < 3 || ! failRead(splits[1], splits.mid(2).join(QLatin1Char('|')))) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Unknown read reply from server" << splits;
             }
 
@@ -183,15 +281,24 @@ void Client::handle(const QString &line) {
         }
 
         QString tagName = splits[1];
-        if (_readingTags.contains(tagName)) {
-            QString timestamp = splits[2];
+        auto reading = _priv->readingTags.find(tagName);
+        if (reading != _priv->readingTags.end()) {
+            RangeRead& read = reading.value().first();
+            qint64 ts = splits[2].toLongLong();
             QMetaType::Type type = static_cast<QMetaType::Type>(splits[3].toInt());
-            QString value = splits[4];
+            const QString& value = splits[4];
 
-            QVariant variantValue = Serialization::deserializeScalarValue(type, value);
-            qint64 ts = timestamp.toLongLong();
-            _readingTags[tagName][0].timestamps.append(QDateTime::fromMSecsSinceEpoch(ts).toUTC());
-            _readingTags[tagName][0].values.append(variantValue);
+            _priv->metrics.add(Metrics::Counter::RangeSamples);
+            if (read.reply && read.reply->canceled()) {
+                return;
+            }
+            if (read.aggregator) {
+                read.aggregator->add(ts, type, value);
+            } else {
+                QVariant variantValue = Serialization::deserializeScalarValue(type, value);
+                read.holder.timestamps.append(QDateTime::fromMSecsSinceEpoch(ts).toUTC());
+                read.holder.values.append(variantValue);
+            }
         } else if (splits.size() >= 7) {
             // direct read
             QString tagName = splits[1];
@@ -202,36 +309,98 @@ void Client::handle(const QString &line) {
             QString quality = splits[6];
 
             updateTag(tagName, timestamp, type, value, unit, quality);
+
+            auto pending = _priv->valueReads.find(tagName);
+            if (pending != _priv->valueReads.end()) {
+                std::shared_ptr<PendingReply> reply = pending.value().dequeue();
+                if (pending.value().isEmpty()) {
+                    _priv->valueReads.erase(pending);
+                }
+                if (! reply->canceled()) {
+                    QMetaType::Type metaType = static_cast<QMetaType::Type>(type.toInt());
+                    reply->valueRead(QDateTime::fromMSecsSinceEpoch(timestamp), metaType, Serialization::deserializeTagValue(metaType, value));
+                }
+                reply->released();
+            }
         } else {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "readReply from server, unknown tagName" << tagName;
         }
     } else if (main == QStringLiteral("readStart")) {
+        scope.command = Metrics::Command::ReadStart;
         if (splits.size() < 4) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown readStart command from server";
             return;
         }
         QString tag = splits[1];
-        ReadTagHolder holder;
-        holder.from = QDateTime::fromMSecsSinceEpoch(splits[2].toLongLong()).toUTC();
-        holder.to   = QDateTime::fromMSecsSinceEpoch(splits[3].toLongLong()).toUTC();
-        _readingTags[tag].append(holder);
+        RangeRead read;
+        read.holder.from = QDateTime::fromMSecsSinceEpoch(splits[2].toLongLong()).toUTC();
+        read.holder.to   = QDateTime::fromMSecsSinceEpoch(splits[3].toLongLong()).toUTC();
+
+        auto requests = _priv->rangeRequests.find(tag);
+        if (requests != _priv->rangeRequests.end()) {
+            RangeRequest request = requests.value().dequeue();
+            if (requests.value().isEmpty()) {
+                _priv->rangeRequests.erase(requests);
+            }
+
+            read.backfill = request.backfill;
+            read.reply = request.reply;
+            if (request.aggregation.buckets > 0) {
+                read.aggregator = std::make_shared<RangeAggregator>(request.aggregation, splits[2].toLongLong(), splits[3].toLongLong());
+            }
+        }
+        _priv->readingTags[tag].append(read);
     } else if (main == QStringLiteral("readEnd")) {
+        scope.command = Metrics::Command::ReadEnd;
         if (splits.size() < 2) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown readEnd command from server";
             return;
         }
 
         QString tag = splits[1];
-        emit tagRead(tag, _readingTags[tag][0]);
+        auto reading = _priv->readingTags.find(tag);
+        if (reading == _priv->readingTags.end()) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
+            qWarning() << "readEnd from server, unknown tagName" << tag;
+            return;
+        }
+
+        RangeRead read = reading.value().takeFirst();
+        if (reading.value().isEmpty()) {
+            _priv->readingTags.erase(reading);
+        }
+
+        if (read.backfill) {
+            replayBackfill(tag, read.holder);
+            return;
+        }
+        if (read.reply && read.reply->canceled()) {
+            read.reply->released();
+            return;
+        }
 
-        _readingTags[tag].removeFirst();
-        if (_readingTags[tag].isEmpty()) {
-            _readingTags.remove(tag);
+        if (read.aggregator) {
+            read.aggregator->finish(read.holder);
+        }
+        if (read.reply) {
+            read.reply->readFinished(read.holder);
+            read.reply->released();
+            return;
         }
+        emit tagRead(tag, read.holder);
     } else if (main == QStringLiteral("subscribe")) {
+        scope.command = Metrics::Command::Subscribe;
         QString subscribeReply = splits[1];
         if (subscribeReply == QStringLiteral("ok")) {
             QString tagName = splits[2];
+            if (! _priv->subscriptions.contains(tagName) && ! _priv->unsubscribed.contains(tagName)) {
+                _priv->subscriptions.insert(tagName, 0);
+            }
+            subscribeAnswered(tagName);
+
             qint64 timestamp = splits[3].toLongLong();
             QString type = splits[4];
             QString value = splits[5];
@@ -239,9 +408,13 @@ void Client::handle(const QString &line) {
             QString quality = splits[7];
 
             updateTag(tagName, timestamp, type, value, unit, quality);
+        } else if (subscribeReply == QStringLiteral("error") && splits.size() >= 3) {
+            subscribeAnswered(splits[2]);
         }
     } else if (main == QStringLiteral("file")) {
+        scope.command = Metrics::Command::File;
         if (splits.size() < 2) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown file reply from server";
             return;
         }
@@ -252,15 +425,22 @@ void Client::handle(const QString &line) {
                 if (! _downloads.empty()) {
                     _downloads.removeFirst();
                 }
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Unknown file OK reply from server";
                 return;
             }
+            if (_downloads.empty()) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
+                qWarning() << "No downloads are active when file ok was received from server";
+                return;
+            }
             auto& download = _downloads.first();
             download.size = splits[2].toLongLong();
 
             emit downloadStarted(download);
         } else if (status == QStringLiteral("error")) {
             if (_downloads.empty()) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "No downloads are active when file error was received from server";
                 return;
             }
@@ -273,6 +453,7 @@ void Client::handle(const QString &line) {
             }
         } else if (status == QStringLiteral("done")) {
             if (_downloads.empty()) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "No downloads are active when file done was received from server";
                 return;
             }
@@ -280,6 +461,7 @@ void Client::handle(const QString &line) {
             auto d = _downloads.takeFirst();
             if (splits.size() < 3) {
                 d.session->fail(DownloadSession::FailReason::Unknown, QString());
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Unknown file done reply from server";
                 return;
             }
@@ -292,11 +474,13 @@ void Client::handle(const QString &line) {
             }
         } else if (status == QStringLiteral("upload")) {
             if (splits.size() < 3) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Unknown file upload reply from server";
                 return;
             }
 
             if (_uploads.isEmpty()) {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "file_upload reply from server, but no active upload sessions";
                 return;
             }
@@ -319,14 +503,18 @@ void Client::handle(const QString &line) {
                 auto session = _uploads.takeFirst();
                 session->fail(UploadSession::FailReason::Server, msg);
             } else {
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Unknown file_upload reply from server";
             }
         } else {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown file reply";
             return;
         }
     } else if (main == QStringLiteral("db")) {
+        scope.command = Metrics::Command::Db;
         if (splits.size() < 3) {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown db reply from server" << splits;
             return;
         }
@@ -336,18 +524,102 @@ void Client::handle(const QString &line) {
 
         if (db_query == "range") {
             if (splits.size() < 5) {
+                // an error in place of the range fails the oldest query of the tag
+                auto pending = _priv->rangeQueries.find(tag);
+                if (pending != _priv->rangeQueries.end()) {
+                    std::shared_ptr<PendingReply> reply = pending.value().dequeue();
+                    if (pending.value().isEmpty()) {
+                        _priv->rangeQueries.erase(pending);
+                    }
+                    reply->failed(splits.mid(3).join(QLatin1Char('|')));
+                    reply->released();
+                    return;
+                }
+
+                _priv->metrics.add(Metrics::Counter::MalformedLines);
                 qWarning() << "Unknown db range reply from server" << splits;
                 return;
             }
 
+            auto pending = _priv->rangeQueries.find(tag);
+            if (pending != _priv->rangeQueries.end()) {
+                std::shared_ptr<PendingReply> reply = pending.value().dequeue();
+                if (pending.value().isEmpty()) {
+                    _priv->rangeQueries.erase(pending);
+                }
+                if (! reply->canceled()) {
+                    reply->rangeQueried(splits[3].toLongLong(), splits[4].toLongLong());
+                }
+                reply->released();
+                return;
+            }
+
             emit tagRange(tag, splits[3].toLongLong(), splits[4].toLongLong());
         } else {
+            _priv->metrics.add(Metrics::Counter::MalformedLines);
             qWarning() << "Unknown db reply" << splits;
         }
     }
 }
 
+void Client::subscribeAnswered(const QString &tag) {
+    auto pending = _priv->subscribing.find(tag);
+    if (pending == _priv->subscribing.end()) {
+        return;
+    }
+    if (--pending.value() <= 0) {
+        _priv->subscribing.erase(pending);
+        _priv->unsubscribed.remove(tag);
+    }
+}
+
+bool Client::failRead(const QString &tag, const QString &description) {
+    auto values = _priv->valueReads.find(tag);
+    auto ranges = _priv->rangeRequests.find(tag);
+    bool value = values != _priv->valueReads.end();
+    bool range = ranges != _priv->rangeRequests.end();
+    if (! value && ! range) {
+        return false;
+    }
+
+    if (value && (! range || values.value().head()->issued < ranges.value().head().issued)) {
+        std::shared_ptr<PendingReply> reply = values.value().dequeue();
+        if (values.value().isEmpty()) {
+            _priv->valueReads.erase(values);
+        }
+        reply->failed(description);
+        reply->released();
+        return true;
+    }
+
+    RangeRequest request = ranges.value().dequeue();
+    if (ranges.value().isEmpty()) {
+        _priv->rangeRequests.erase(ranges);
+    }
+    if (request.reply) {
+        request.reply->failed(description);
+        request.reply->released();
+    } else if (request.backfill) {
+        // the outage window stays a gap, the held live updates still go out
+        replayBackfill(tag, ReadTagHolder());
+    } else {
+        emit tagReadFailed(tag, request.from, request.to);
+    }
+    return true;
+}
+
 void Client::handleDownload(const QByteArray &bytes) {
+    _priv->metrics.add(Metrics::Counter::BinaryBytesReceived, quint64(bytes.size()));
+    if (_priv->capture) {
+        _priv->capture->write(CaptureRecord::Kind::Binary, bytes);
+    }
+
+    if (_downloads.empty()) {
+        _priv->metrics.add(Metrics::Counter::MalformedLines);
+        qWarning() << "No downloads are active when binary data was received from server";
+        return;
+    }
+
     auto& d = _downloads.first();
     if ((d.received + bytes.size()) >= d.size) {
         qint64 rest = d.size - d.received;
@@ -366,6 +638,7 @@ std::shared_ptr<DownloadSession> Client::createDownloadSession() {
     download.session = std::make_shared<DownloadSession>();
     download.hashfn = std::make_shared<QCryptographicHash>(eDrillingHub::Protocol::hashing_algorithm);
     _downloads.append(download);
+    updateGauges();
 
     connect(download.session.get(), &DownloadSession::download, this, [this](const QString& file) {
         write(eDrillingHub::Protocol::FileTransfer(file));
@@ -377,6 +650,7 @@ std::shared_ptr<DownloadSession> Client::createDownloadSession() {
 std::shared_ptr<UploadSession> Client::createUploadSession() {
     auto session = std::make_shared<UploadSession>();
     _uploads.append(session);
+    updateGauges();
 
     connect(session.get(), &UploadSession::server_request, this, [this, session] {
         write(eDrillingHub::Protocol::FileUploadRequest(session->filename(), session->size()));
@@ -391,6 +665,322 @@ std::shared_ptr<UploadSession> Client::createUploadSession() {
     return session;
 }
 
+void Client::readTagRange(const QString &tag, const QDateTime &from, const QDateTime &to) {
+    readTagRange(tag, from, to, Aggregation());
+}
+
+void Client::readTagRange(const QString &tag, const QDateTime &from, const QDateTime &to, const Aggregation &aggregation) {
+    RangeRequest request;
+    request.issued = ++_priv->issued;
+    request.from = from.toUTC();
+    request.to = to.toUTC();
+    request.aggregation = aggregation;
+    _priv->rangeRequests[tag].enqueue(request);
+
+    write(Protocol::ReadTagRange(tag, from, to));
+}
+
+void Client::writeBatch(const QStringList &messages) {
+    for (const auto& message : messages) {
+        write(message);
+    }
+}
+
+void Client::writeEncoded(const CommandEncoder &commands) {
+    const QByteArray& buffer = commands.buffer();
+    int from = 0;
+    int to;
+    while ((to = buffer.indexOf("\r\n", from)) >= 0) {
+        write(QString::fromUtf8(buffer.constData() + from, to - from));
+        from = to + 2;
+    }
+}
+
+void Client::subscribe(const QString &tag) {
+    if (! _priv->subscriptions.contains(tag)) {
+        _priv->subscriptions.insert(tag, 0);
+    }
+    _priv->unsubscribed.remove(tag);
+    _priv->subscribing[tag]++;
+    write(Protocol::SubscribeTag(tag));
+}
+
+void Client::subscribe(const QStringList &tags) {
+    CommandEncoder messages;
+
+    for (const auto& tag : tags) {
+        if (! _priv->subscriptions.contains(tag)) {
+            _priv->subscriptions.insert(tag, 0);
+        }
+        _priv->unsubscribed.remove(tag);
+        _priv->subscribing[tag]++;
+
+        messages.subscribeTag(tag);
+        if (messages.commands() == subscribe_batch_size) {
+            writeEncoded(messages);
+            messages.clear();
+        }
+    }
+
+    if (! messages.isEmpty()) {
+        writeEncoded(messages);
+    }
+}
+
+void Client::unsubscribe(const QString &tag) {
+    unsubscribe(QStringList(tag));
+}
+
+void Client::unsubscribe(const QStringList &tags) {
+    CommandEncoder messages;
+
+    for (const auto& tag : tags) {
+        _priv->subscriptions.remove(tag);
+        _priv->backfilling.remove(tag);
+        if (_priv->subscribing.contains(tag)) {
+            _priv->unsubscribed.insert(tag);
+        }
+
+        messages.unsubscribeTag(tag);
+        if (messages.commands() == subscribe_batch_size) {
+            writeEncoded(messages);
+            messages.clear();
+        }
+    }
+
+    if (! messages.isEmpty()) {
+        writeEncoded(messages);
+    }
+}
+
+void Client::unsubscribeAll() {
+    _priv->subscriptions.clear();
+    _priv->backfilling.clear();
+    _priv->unsubscribed.clear();
+    for (auto it = _priv->subscribing.cbegin(); it != _priv->subscribing.cend(); ++it) {
+        _priv->unsubscribed.insert(it.key());
+    }
+    if (_priv->subscriptionManager) {
+        _priv->subscriptionManager->reset();
+    }
+    write(Protocol::UnsubscribeAllCommand);
+}
+
+const TagCatalog& Client::catalog() const {
+    return _priv->catalog;
+}
+
+SubscriptionManager* Client::subscriptionManager() {
+    if (! _priv->subscriptionManager) {
+        _priv->subscriptionManager.reset(new SubscriptionManager(this));
+    }
+    return _priv->subscriptionManager.get();
+}
+
+QStringList Client::subscriptions() const {
+    return _priv->subscriptions.keys();
+}
+
+void Client::setAutoReconnect(bool enable, int initialDelay, int maxDelay) {
+    _priv->autoReconnect = enable;
+    _priv->reconnectInitialDelay = std::max(initialDelay, 1);
+    _priv->reconnectMaxDelay = std::max(maxDelay, _priv->reconnectInitialDelay);
+
+    if (! enable) {
+        _priv->reconnectTimer.stop();
+        _priv->reconnecting = false;
+    }
+}
+
+void Client::setLatencyTracking(bool enable) {
+    if (! enable) {
+        _priv->latency.reset();
+    } else if (! _priv->latency) {
+        _priv->latency.reset(new LatencyTracker());
+        _priv->receivedAtWall = 0;
+    }
+}
+
+LatencyTracker* Client::latency() {
+    return _priv->latency.get();
+}
+
+void Client::setLiveHistory(bool enable) {
+    if (! enable) {
+        _priv->liveHistory.reset();
+    } else if (! _priv->liveHistory) {
+        _priv->liveHistory.reset(new LiveHistory());
+    }
+}
+
+LiveHistory* Client::liveHistory() {
+    return _priv->liveHistory.get();
+}
+
+void Client::setCapture(QIODevice *device) {
+    if (device) {
+        _priv->capture.reset(new CaptureWriter(device));
+    } else {
+        _priv->capture.reset();
+    }
+}
+
+const Metrics& Client::metrics() const {
+    return _priv->metrics;
+}
+
+void Client::updateGauges() {
+    _priv->metrics.set(Metrics::Gauge::ReadingTags, _priv->readingTags.size());
+    _priv->metrics.set(Metrics::Gauge::PendingRangeRequests, _priv->rangeRequests.size());
+    _priv->metrics.set(Metrics::Gauge::Subscriptions, _priv->subscriptions.size());
+    _priv->metrics.set(Metrics::Gauge::Downloads, _downloads.size());
+    _priv->metrics.set(Metrics::Gauge::Uploads, _uploads.size());
+}
+
+void Client::onConnected() {
+    _priv->reconnectAttempt = 0;
+    if (! _priv->reconnecting) {
+        return;
+    }
+
+    _priv->reconnecting = false;
+    _priv->metrics.add(Metrics::Counter::Reconnects);
+    resubscribe();
+}
+
+void Client::onDisconnected() {
+    // replies to anything in flight will never arrive
+    QList<std::shared_ptr<PendingReply>> aborted;
+    struct FailedRead {
+        QString tag;
+        QDateTime from, to;
+    };
+    QList<FailedRead> failedReads;
+    for (auto it = _priv->rangeRequests.cbegin(); it != _priv->rangeRequests.cend(); ++it) {
+        for (const auto& request : it.value()) {
+            if (request.reply) {
+                aborted.append(request.reply);
+            } else if (! request.backfill) {
+                failedReads.append(FailedRead{it.key(), request.from, request.to});
+            }
+        }
+    }
+    for (auto it = _priv->readingTags.cbegin(); it != _priv->readingTags.cend(); ++it) {
+        for (const auto& read : it.value()) {
+            if (read.reply) {
+                aborted.append(read.reply);
+            } else if (! read.backfill) {
+                failedReads.append(FailedRead{it.key(), read.holder.from, read.holder.to});
+            }
+        }
+    }
+    for (const auto& replies : _priv->valueReads) {
+        aborted.append(replies);
+    }
+    for (const auto& replies : _priv->rangeQueries) {
+        aborted.append(replies);
+    }
+
+    _priv->rangeRequests.clear();
+    _priv->readingTags.clear();
+    _priv->valueReads.clear();
+    _priv->rangeQueries.clear();
+    _priv->backfilling.clear();
+    // no subscribe reply outlives the connection
+    _priv->subscribing.clear();
+    _priv->unsubscribed.clear();
+
+    for (const auto& reply : aborted) {
+        reply->aborted();
+        reply->released();
+    }
+    for (const auto& read : failedReads) {
+        emit tagReadFailed(read.tag, read.from, read.to);
+    }
+
+    if (! _priv->autoReconnect || _priv->closing) {
+        return;
+    }
+
+    int delay = _priv->reconnectMaxDelay;
+    if (_priv->reconnectAttempt < 16) {
+        delay = std::min(_priv->reconnectInitialDelay << _priv->reconnectAttempt, _priv->reconnectMaxDelay);
+    }
+    _priv->reconnectAttempt++;
+    _priv->reconnecting = true;
+
+    emit reconnecting(_priv->reconnectAttempt, delay);
+    _priv->reconnectTimer.start(delay);
+}
+
+void Client::resubscribe() {
+    CommandEncoder messages;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    // backfills go out first so the server starts streaming history right away
+    for (auto it = _priv->subscriptions.cbegin(); it != _priv->subscriptions.cend(); ++it) {
+        qint64 lastSeen = it.value();
+        if (lastSeen <= 0 || lastSeen >= now) {
+            continue;
+        }
+
+        RangeRequest request;
+        request.issued = ++_priv->issued;
+        request.backfill = true;
+        _priv->rangeRequests[it.key()].enqueue(request);
+        _priv->backfilling.insert(it.key(), QList<HeldUpdate>());
+
+        messages.readTagRange(it.key(), lastSeen + 1, now);
+    }
+    for (auto it = _priv->subscriptions.cbegin(); it != _priv->subscriptions.cend(); ++it) {
+        _priv->subscribing[it.key()]++;
+        messages.subscribeTag(it.key());
+    }
+
+    if (! messages.isEmpty()) {
+        writeEncoded(messages);
+    }
+}
+
+void Client::replayBackfill(const QString &tag, const ReadTagHolder &data) {
+    QList<HeldUpdate> held = _priv->backfilling.take(tag);
+    if (! _priv->subscriptions.contains(tag)) {
+        return;
+    }
+
+    qint64 last = _priv->subscriptions.value(tag);
+    for (int i = 0; i < data.values.size() && i < data.timestamps.size(); i++) {
+        qint64 ts = data.timestamps[i].toMSecsSinceEpoch();
+        if (ts <= last) {
+            continue;
+        }
+
+        last = ts;
+        const QVariant& value = data.values[i];
+        if (_priv->liveHistory) {
+            _priv->liveHistory->append(tag, ts, static_cast<QMetaType::Type>(value.userType()), value);
+        }
+        emit tagValueUpdated(tag, data.timestamps[i], static_cast<QMetaType::Type>(value.userType()), value);
+    }
+
+    for (const auto& update : held) {
+        qint64 ts = update.timestamp.toMSecsSinceEpoch();
+        if (ts <= last) {
+            continue;
+        }
+
+        last = ts;
+        if (_priv->liveHistory) {
+            _priv->liveHistory->append(tag, ts, update.metaType, update.value);
+        }
+        emit tagValueUpdated(tag, update.timestamp, update.metaType, update.value);
+    }
+
+    if (_priv->subscriptions.contains(tag)) {
+        _priv->subscriptions.insert(tag, last);
+    }
+}
+
 void Client::processDownload(const QByteArray &data) {
     auto& d = _downloads.first();
     d.received += data.size();
@@ -1,15 +1,24 @@
 #pragma once
 
 #include <QObject>
+#include <QStringList>
 #include <memory>
 
 #include <QtNetwork/QAbstractSocket>
 
 #include "edhtypes.h"
 #include "edhprotocol.h"
+#include "edhaggregation.h"
+#include "edhlatency.h"
+#include "edhmetrics.h"
+#include "edhcapture.h"
+#include "edhcatalog.h"
+#include "edhlivehistory.h"
 
 namespace eDrillingHub {
     struct ClientPrivate;
+    class CommandEncoder;
+    class SubscriptionManager;
 
     class EXPORT_LIBEDRILLINGHUB_SPEC Client : public QObject {
         Q_OBJECT
@@ -27,13 +36,58 @@ namespace eDrillingHub {
 
         virtual void write(const QString& message) = 0;
         virtual void writeBinary(const QByteArray& data) = 0;
+        virtual void writeBatch(const QStringList& messages);
+        // sends every command the encoder holds, as one write where the transport allows it
+        virtual void writeEncoded(const CommandEncoder& commands);
         std::shared_ptr<DownloadSession> createDownloadSession();
         std::shared_ptr<UploadSession> createUploadSession();
+
+        // replies are matched to requests per tag in order, range reads must not bypass these
+        void readTagRange(const QString& tag, const QDateTime& from, const QDateTime& to);
+        void readTagRange(const QString& tag, const QDateTime& from, const QDateTime& to, const Aggregation& aggregation);
+
+        void subscribe(const QString& tag);
+        // pipelines the commands without waiting for replies, up to 1000 per write
+        void subscribe(const QStringList& tags);
+        void unsubscribe(const QString& tag);
+        void unsubscribe(const QStringList& tags);
+        void unsubscribeAll();
+        QStringList subscriptions() const;
+        // shares subscriptions between consumers, see SubscriptionManager
+        SubscriptionManager* subscriptionManager();
+
+        // every tag seen in browse, read and subscribe replies
+        const TagCatalog& catalog() const;
+
+        /**
+         * @brief setAutoReconnect - reopen dropped connections with exponential backoff
+         *
+         * After reconnecting, every tracked subscription is replayed in one batch and the
+         * outage window of each tag is backfilled through ReadTagRange. Backfilled samples
+         * are delivered through tagValueUpdated ahead of the live updates that arrived
+         * meanwhile, so consumers see one continuous series.
+         */
+        void setAutoReconnect(bool enable, int initialDelay = 500, int maxDelay = 30000);
+
+        void setLatencyTracking(bool enable);
+        // nullptr unless latency tracking is enabled
+        LatencyTracker* latency();
+
+        void setLiveHistory(bool enable);
+        // nullptr unless live history is enabled, tags are tracked through LiveHistory
+        LiveHistory* liveHistory();
+
+        const Metrics& metrics() const;
+
+        // records every inbound line and binary frame to device, nullptr stops
+        void setCapture(QIODevice* device);
     signals:
         void tagValueUpdated(const QString& tagName, const QDateTime& timestamp, QMetaType::Type metaType, const QVariant& variantValue);
         void tagQualityUpdated(const QString& tagName, Tag::Quality::Value ioTagQuality);
         void tagUnitUpdated(const QString& tagName, const QString& unit);
         void tagRead(const QString& tag, const ReadTagHolder& data);
+        // a readTagRange the connection dropped before its reply completed
+        void tagReadFailed(const QString& tag, const QDateTime& from, const QDateTime& to);
         void tagRange(const QString& tag, qint64 start, qint64 end);
         void tagsImported();
 
@@ -44,20 +98,36 @@ namespace eDrillingHub {
 
         void connected();
         void disconnected();
+        void reconnecting(int attempt, int delay);
     protected:
         void handle(const QString& line);
         void handleDownload(const QByteArray& bytes);
+        // called by transports when data arrives, before the lines are handled
+        void received();
 
         std::unique_ptr<QNetworkProxy> _networkProxy;
         std::unique_ptr<ClientPrivate> _priv;
     private:
+        friend class CaptureReplay;
+        friend class AsyncClient;
+
         void updateTagValue(const QString& tagName, qint64 timestamp, const QString& type, const QString& value);
         void updateTagQuality(const QString& tagName, const QString& quality);
         void updateTagUnit(const QString& tagName, const QString& unit);
         void updateTag(const QString& tagName, qint64 timestamp, const QString& type, const QString& value, const QString &unit, const QString &quality);
         void processDownload(const QByteArray &data);
 
-        QHash<QString, QList<ReadTagHolder>> _readingTags;
+        void deliverTagValue(const QString& tagName, const QDateTime& timestamp, QMetaType::Type metaType, const QVariant& variantValue);
+        void onConnected();
+        void onDisconnected();
+        void resubscribe();
+        void replayBackfill(const QString& tag, const ReadTagHolder& data);
+        // one subscribe command for tag got its reply, forgets the tag's unsubscribe once none is left
+        void subscribeAnswered(const QString& tag);
+        // fails the oldest read of tag still waiting for its reply, false when there is none
+        bool failRead(const QString& tag, const QString& description);
+        void updateGauges();
+
         QVector<Download> _downloads;
         QVector<std::shared_ptr<UploadSession>> _uploads;
     };
@@ -1,10 +1,98 @@
 #pragma once
 
 #include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+
+#include "edhprotocol.h"
+#include "edhaggregation.h"
+#include "edhlatency.h"
+#include "edhmetrics.h"
+#include "edhsubscriptions.h"
 
 namespace eDrillingHub {
+    // completes a request issued through AsyncClient in place of the global signals
+    struct PendingReply {
+        // ClientPrivate::issued when the command was written
+        quint64 issued = 0;
+
+        virtual ~PendingReply() {}
+        // replies of canceled requests are still consumed but not buffered
+        virtual bool canceled() const = 0;
+        virtual void readFinished(const ReadTagHolder&) {}
+        virtual void valueRead(const QDateTime&, QMetaType::Type, const QVariant&) {}
+        virtual void rangeQueried(qint64, qint64) {}
+        // the server answered with an error
+        virtual void failed(const QString& description) = 0;
+        virtual void aborted() = 0;
+        // called last, once the reply has been consumed or the connection dropped
+        virtual void released() = 0;
+    };
+
+    struct RangeRequest {
+        quint64 issued = 0;
+        QDateTime from, to;
+        Aggregation aggregation;
+        bool backfill = false;
+        std::shared_ptr<PendingReply> reply;
+    };
+
+    struct RangeRead {
+        ReadTagHolder holder;
+        std::shared_ptr<RangeAggregator> aggregator;
+        bool backfill = false;
+        std::shared_ptr<PendingReply> reply;
+    };
+
+    struct HeldUpdate {
+        QDateTime timestamp;
+        QMetaType::Type metaType;
+        QVariant value;
+    };
+
     struct ClientPrivate {
         QString host;
         quint16 port;
+
+        // requests issued through Client, matched against readStart in order
+        QHash<QString, QQueue<RangeRequest>> rangeRequests;
+        QHash<QString, QList<RangeRead>> readingTags;
+        // single reads and range queries issued through AsyncClient, matched in order
+        QHash<QString, QQueue<std::shared_ptr<PendingReply>>> valueReads;
+        QHash<QString, QQueue<std::shared_ptr<PendingReply>>> rangeQueries;
+        // counts the reads written, an error reply fails the oldest read of its tag
+        quint64 issued = 0;
+
+        // subscribed tags and the timestamp of the last delivered value
+        QHash<QString, qint64> subscriptions;
+        // live updates held back while the outage window of a tag is backfilled
+        QHash<QString, QList<HeldUpdate>> backfilling;
+        // explicitly unsubscribed while a subscribe reply was outstanding, that reply must not track them again
+        QSet<QString> unsubscribed;
+        // subscribe commands per tag still waiting for their reply
+        QHash<QString, int> subscribing;
+        std::unique_ptr<SubscriptionManager> subscriptionManager;
+        TagCatalog catalog;
+
+        bool autoReconnect = false;
+        bool reconnecting = false;
+        bool closing = false;
+        int reconnectAttempt = 0;
+        int reconnectInitialDelay = 500;
+        int reconnectMaxDelay = 30000;
+        QTimer reconnectTimer;
+
+        Metrics metrics;
+        std::unique_ptr<CaptureWriter> capture;
+        std::unique_ptr<LatencyTracker> latency;
+        std::unique_ptr<LiveHistory> liveHistory;
+        QElapsedTimer clock;
+        qint64 receivedAt = 0;      // clock nsecs
+        qint64 receivedAtWall = 0;  // msecs since epoch
+        qint64 handleStarted = 0;   // clock nsecs
     };
 }
@@ -1,5 +1,6 @@
 #include "edhclient_socket.h"
 #include "edhclient_private.h"
+#include "edhencoder.h"
 
 #include <iostream>
 
@@ -18,6 +19,11 @@ SocketClient::SocketClient(bool secure) {
         auto socket = new QSslSocket();
         _socket.reset(socket);
         _ssl_socket = true;
+
+        // connected once, the socket is reused when reconnecting
+        connect(socket, &QSslSocket::encrypted, this, [this] {
+            emit connected();
+        });
     } else {
         _socket.reset(new QTcpSocket());
         _ssl_socket = false;
@@ -30,15 +36,17 @@ SocketClient::SocketClient(bool secure) {
             _socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
             if (_ssl_socket) {
                 auto sslsocket = dynamic_cast<QSslSocket*>(_socket.get());
-                QObject::connect(sslsocket, &QSslSocket::encrypted, [=] {
-                    emit connected();
-                });
                 sslsocket->startClientEncryption();
             } else {
                 emit connected();
             }
             break;
         case QAbstractSocket::UnconnectedState:
+            // a line cut off by the drop must not be glued to the first line of the next connection
+            _readBuffer.clear();
+            _readBufferIdx = 0;
+            _readBufferPos = 0;
+            _priv->metrics.set(Metrics::Gauge::ReadBufferBytes, 0);
             emit disconnected();
             break;
         default:
@@ -68,6 +76,8 @@ SocketClient* SocketClient::create(bool secure) {
 }
 
 void SocketClient::open() {
+    _priv->closing = false;
+
     if (_networkProxy) {
         _socket->setProxy(*_networkProxy);
     }
@@ -75,6 +85,9 @@ void SocketClient::open() {
 }
 
 void SocketClient::close() {
+    _priv->closing = true;
+    _priv->reconnectTimer.stop();
+
     _socket->close();
 }
 
@@ -98,8 +111,32 @@ QString SocketClient::errorString() {
 }
 
 void SocketClient::write(const QString &message) {
-    _socket->write(message.toUtf8());
-    _socket->write(message_end_marker.toUtf8());
+    _writeBuffer.resize(0);
+    CommandEncoder::appendUtf8(_writeBuffer, message);
+    _writeBuffer.append("\r\n", 2);
+    _socket->write(_writeBuffer);
+
+    _priv->metrics.add(Metrics::Counter::LinesSent);
+    _priv->metrics.add(Metrics::Counter::BytesSent, quint64(_writeBuffer.size()));
+}
+
+void SocketClient::writeBatch(const QStringList &messages) {
+    _writeBuffer.resize(0);
+    for (const auto& message : messages) {
+        CommandEncoder::appendUtf8(_writeBuffer, message);
+        _writeBuffer.append("\r\n", 2);
+    }
+    _socket->write(_writeBuffer);
+
+    _priv->metrics.add(Metrics::Counter::LinesSent, quint64(messages.size()));
+    _priv->metrics.add(Metrics::Counter::BytesSent, quint64(_writeBuffer.size()));
+}
+
+void SocketClient::writeEncoded(const CommandEncoder &commands) {
+    _socket->write(commands.buffer());
+
+    _priv->metrics.add(Metrics::Counter::LinesSent, quint64(commands.commands()));
+    _priv->metrics.add(Metrics::Counter::BytesSent, quint64(commands.buffer().size()));
 }
 
 void SocketClient::writeBinary(const QByteArray &data) {
@@ -107,8 +144,11 @@ void SocketClient::writeBinary(const QByteArray &data) {
 }
 
 void SocketClient::_onSocketReadyRead() {
+    received();
+
     QByteArray bytes = _socket->readAll();
     _readBuffer.append(bytes);
+    _priv->metrics.add(Metrics::Counter::BytesReceived, quint64(bytes.size()));
 
     _readBufferIdx = 0;
     _readBufferPos = _readBuffer.indexOf(message_end_marker);
@@ -125,6 +165,7 @@ void SocketClient::_onSocketReadyRead() {
 
         _readBuffer.remove(0, _readBufferIdx);
     }
+    _priv->metrics.set(Metrics::Gauge::ReadBufferBytes, _readBuffer.size());
 }
 
 void SocketClient::_onSslError(const QList<QSslError> &errors) {
@@ -18,6 +18,8 @@ namespace eDrillingHub {
 
         void write(const QString& message);
         void writeBinary(const QByteArray& data);
+        void writeBatch(const QStringList& messages);
+        void writeEncoded(const CommandEncoder& commands);
     private:
         SocketClient(bool secure);
 
@@ -30,5 +32,7 @@ namespace eDrillingHub {
         int _readBufferIdx = 0;
         int _readBufferPos = 0;
         QByteArray _readBuffer;
+        // reused by write() and writeBatch(), keeps its capacity between calls
+        QByteArray _writeBuffer;
     };
 }
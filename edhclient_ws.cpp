@@ -1,5 +1,6 @@
 #include "edhclient_ws.h"
 #include "edhclient_private.h"
+#include "edhencoder.h"
 
 #include <iostream>
 
@@ -15,6 +16,8 @@ WebsocketClient::WebsocketClient(bool secure) : _ssl_socket(secure) {
     _ws.reset(new QWebSocket);
 
     connect(_ws.get(), &QWebSocket::textMessageReceived, this, [this](const QString &message) {
+        received();
+        _priv->metrics.add(Metrics::Counter::BytesReceived, quint64(CommandEncoder::utf8Size(message)));
         handle(message);
     });
     connect(_ws.get(), &QWebSocket::binaryFrameReceived, this, [this](const QByteArray &frame, bool isLastFrame) {
@@ -70,6 +73,8 @@ void WebsocketClient::open() {
     url.setPort(_priv->port);
     url.setPath("/edh");
 
+    _priv->closing = false;
+
     if (_networkProxy) {
         _ws->setProxy(*_networkProxy);
     }
@@ -77,6 +82,9 @@ void WebsocketClient::open() {
 }
 
 void WebsocketClient::close() {
+    _priv->closing = true;
+    _priv->reconnectTimer.stop();
+
     _ws->close();
 }
 
@@ -96,6 +104,36 @@ QString WebsocketClient::errorString() {
 
 void WebsocketClient::write(const QString &message) {
     _ws->sendTextMessage(message);
+
+    _priv->metrics.add(Metrics::Counter::LinesSent);
+    _priv->metrics.add(Metrics::Counter::BytesSent, quint64(CommandEncoder::utf8Size(message)));
+}
+
+// the hub reads one command per text message, so a batch is a run of frames flushed together
+void WebsocketClient::writeBatch(const QStringList &messages) {
+    quint64 bytes = 0;
+    for (const auto& message : messages) {
+        _ws->sendTextMessage(message);
+        bytes += quint64(CommandEncoder::utf8Size(message));
+    }
+    _ws->flush();
+
+    _priv->metrics.add(Metrics::Counter::LinesSent, quint64(messages.size()));
+    _priv->metrics.add(Metrics::Counter::BytesSent, bytes);
+}
+
+void WebsocketClient::writeEncoded(const CommandEncoder &commands) {
+    const QByteArray& buffer = commands.buffer();
+    int from = 0;
+    int to;
+    while ((to = buffer.indexOf("\r\n", from)) >= 0) {
+        _ws->sendTextMessage(QString::fromUtf8(buffer.constData() + from, to - from));
+        from = to + 2;
+    }
+    _ws->flush();
+
+    _priv->metrics.add(Metrics::Counter::LinesSent, quint64(commands.commands()));
+    _priv->metrics.add(Metrics::Counter::BytesSent, quint64(buffer.size() - 2 * commands.commands()));
 }
 
 void WebsocketClient::writeBinary(const QByteArray &data) {
@@ -18,6 +18,8 @@ namespace eDrillingHub {
 
         void write(const QString& message);
         void writeBinary(const QByteArray& data);
+        void writeBatch(const QStringList& messages);
+        void writeEncoded(const CommandEncoder& commands);
     private:
         WebsocketClient(bool secure);
 
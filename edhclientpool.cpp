@@ -0,0 +1,204 @@
+#include "edhclientpool.h"
+
+#include <QtNetwork/QNetworkProxy>
+
+using namespace eDrillingHub;
+
+ClientPool::~ClientPool() {
+}
+
+ClientPool* ClientPool::create(const QUrl &url, int connections) {
+    if (connections < 1) {
+        qWarning() << "ClientPool needs at least one connection";
+        return nullptr;
+    }
+
+    std::unique_ptr<ClientPool> pool(new ClientPool());
+    for (int i = 0; i < connections; i++) {
+        std::shared_ptr<Client> client(Client::create(url));
+        if (! client) {
+            return nullptr;
+        }
+
+        pool->_clients.append(client);
+        pool->_inFlight.append(0);
+        pool->_connected.append(false);
+        pool->attach(i);
+    }
+
+    return pool.release();
+}
+
+void ClientPool::attach(int index) {
+    Client* client = _clients[index].get();
+
+    connect(client, &Client::tagValueUpdated, this, &ClientPool::tagValueUpdated);
+    connect(client, &Client::tagQualityUpdated, this, &ClientPool::tagQualityUpdated);
+    connect(client, &Client::tagUnitUpdated, this, &ClientPool::tagUnitUpdated);
+    connect(client, &Client::tagRange, this, &ClientPool::tagRange);
+    connect(client, &Client::tagsImported, this, &ClientPool::tagsImported);
+    connect(client, &Client::downloadStarted, this, &ClientPool::downloadStarted);
+    connect(client, &Client::downloadFinished, this, &ClientPool::downloadFinished);
+    connect(client, &Client::socketError, this, &ClientPool::socketError);
+
+    connect(client, &Client::tagRead, this, [this, index](const QString& tag, const ReadTagHolder& data) {
+        if (_inFlight[index] > 0) {
+            _inFlight[index]--;
+        }
+        emit tagRead(tag, data);
+    });
+    // a failed read is answered as well, its slot must not stay taken
+    connect(client, &Client::tagReadFailed, this, [this, index](const QString& tag, const QDateTime& from, const QDateTime& to) {
+        if (_inFlight[index] > 0) {
+            _inFlight[index]--;
+        }
+        emit tagReadFailed(tag, from, to);
+    });
+    // failed connect attempts report disconnected as well, only a change of state counts
+    connect(client, &Client::connected, this, [this, index] {
+        if (_connected[index]) {
+            return;
+        }
+        _connected[index] = true;
+        if (allConnected()) {
+            emit connected();
+        }
+    });
+    connect(client, &Client::disconnected, this, [this, index] {
+        _inFlight[index] = 0;
+        if (! _connected[index]) {
+            return;
+        }
+        bool wasConnected = allConnected();
+        _connected[index] = false;
+        if (wasConnected) {
+            emit disconnected();
+        }
+    });
+}
+
+bool ClientPool::allConnected() const {
+    return ! _connected.contains(false);
+}
+
+void ClientPool::open() {
+    for (const auto& client : _clients) {
+        client->open();
+    }
+}
+
+void ClientPool::close() {
+    for (const auto& client : _clients) {
+        client->close();
+    }
+}
+
+void ClientPool::proxy(const QNetworkProxy &networkProxy) {
+    for (const auto& client : _clients) {
+        client->proxy(networkProxy);
+    }
+}
+
+void ClientPool::setIgnoreSslErrors(bool enable) {
+    for (const auto& client : _clients) {
+        client->setIgnoreSslErrors(enable);
+    }
+}
+
+void ClientPool::setAutoReconnect(bool enable, int initialDelay, int maxDelay) {
+    for (const auto& client : _clients) {
+        client->setAutoReconnect(enable, initialDelay, maxDelay);
+    }
+}
+
+Client* ClientPool::clientForTag(const QString &tag) const {
+    return _clients[shardOf(tag)].get();
+}
+
+int ClientPool::shardOf(const QString &tag) const {
+    return int(qHash(tag) % uint(_clients.size()));
+}
+
+QVector<QStringList> ClientPool::shard(const QStringList &tags) const {
+    QVector<QStringList> shards(_clients.size());
+    for (const auto& tag : tags) {
+        shards[shardOf(tag)].append(tag);
+    }
+    return shards;
+}
+
+int ClientPool::leastLoaded() const {
+    int best = 0;
+    for (int i = 1; i < _inFlight.size(); i++) {
+        if (_inFlight[i] < _inFlight[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void ClientPool::subscribe(const QString &tag) {
+    clientForTag(tag)->subscribe(tag);
+}
+
+void ClientPool::subscribe(const QStringList &tags) {
+    QVector<QStringList> shards = shard(tags);
+    for (int i = 0; i < shards.size(); i++) {
+        if (! shards[i].isEmpty()) {
+            _clients[i]->subscribe(shards[i]);
+        }
+    }
+}
+
+void ClientPool::unsubscribe(const QString &tag) {
+    clientForTag(tag)->unsubscribe(tag);
+}
+
+void ClientPool::unsubscribe(const QStringList &tags) {
+    QVector<QStringList> shards = shard(tags);
+    for (int i = 0; i < shards.size(); i++) {
+        if (! shards[i].isEmpty()) {
+            _clients[i]->unsubscribe(shards[i]);
+        }
+    }
+}
+
+void ClientPool::unsubscribeAll() {
+    for (const auto& client : _clients) {
+        client->unsubscribeAll();
+    }
+}
+
+void ClientPool::readTag(const QString &tag) {
+    clientForTag(tag)->write(Protocol::ReadTag(tag));
+}
+
+void ClientPool::readTagRange(const QString &tag, const QDateTime &from, const QDateTime &to) {
+    int index = leastLoaded();
+    _inFlight[index]++;
+    _clients[index]->readTagRange(tag, from, to);
+}
+
+void ClientPool::readTagRange(const QString &tag, const QDateTime &from, const QDateTime &to, const Aggregation &aggregation) {
+    int index = leastLoaded();
+    _inFlight[index]++;
+    _clients[index]->readTagRange(tag, from, to, aggregation);
+}
+
+void ClientPool::queryTagRange(const QString &tag) {
+    clientForTag(tag)->write(Protocol::QueryTagRange(tag));
+}
+
+void ClientPool::writeTag(const QString &tagName, const QDateTime &timestamp, const QVariant &value) {
+    clientForTag(tagName)->write(Protocol::WriteTag(tagName, timestamp, value));
+}
+
+void ClientPool::broadcast(const QString &message) {
+    for (const auto& client : _clients) {
+        client->write(message);
+    }
+}
+
+std::shared_ptr<DownloadSession> ClientPool::createDownloadSession() {
+    return _clients[leastLoaded()]->createDownloadSession();
+}
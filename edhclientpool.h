@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <memory>
+
+#include "edhclient.h"
+
+namespace eDrillingHub {
+    /**
+     * @brief ClientPool - several connections to the same hub behind one client surface
+     *
+     * Subscriptions and single-tag commands are sharded on the tag name, so a tag always
+     * lives on the same connection. Range reads and file downloads go to the connection with
+     * the fewest outstanding range reads. All signals of the connections are merged.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC ClientPool : public QObject {
+        Q_OBJECT
+    public:
+        virtual ~ClientPool();
+        static ClientPool* create(const QUrl& url, int connections);
+
+        void open();
+        void close();
+
+        void proxy(const QNetworkProxy &networkProxy);
+        void setIgnoreSslErrors(bool enable);
+        void setAutoReconnect(bool enable, int initialDelay = 500, int maxDelay = 30000);
+
+        int size() const { return _clients.size(); }
+        Client* client(int index) const { return _clients[index].get(); }
+        Client* clientForTag(const QString& tag) const;
+
+        void subscribe(const QString& tag);
+        // one pipelined batch per connection
+        void subscribe(const QStringList& tags);
+        void unsubscribe(const QString& tag);
+        void unsubscribe(const QStringList& tags);
+        void unsubscribeAll();
+        void readTag(const QString& tag);
+        void readTagRange(const QString& tag, const QDateTime& from, const QDateTime& to);
+        void readTagRange(const QString& tag, const QDateTime& from, const QDateTime& to, const Aggregation& aggregation);
+        void queryTagRange(const QString& tag);
+        void writeTag(const QString& tagName, const QDateTime& timestamp, const QVariant& value);
+        void broadcast(const QString& message);
+
+        std::shared_ptr<DownloadSession> createDownloadSession();
+    signals:
+        void tagValueUpdated(const QString& tagName, const QDateTime& timestamp, QMetaType::Type metaType, const QVariant& variantValue);
+        void tagQualityUpdated(const QString& tagName, Tag::Quality::Value ioTagQuality);
+        void tagUnitUpdated(const QString& tagName, const QString& unit);
+        void tagRead(const QString& tag, const ReadTagHolder& data);
+        void tagReadFailed(const QString& tag, const QDateTime& from, const QDateTime& to);
+        void tagRange(const QString& tag, qint64 start, qint64 end);
+        void tagsImported();
+
+        void downloadStarted(const Download& session);
+        void downloadFinished(const Download& session, const QByteArray& rest_bytes);
+
+        void socketError(QAbstractSocket::SocketError error);
+
+        // connected once every connection is up, disconnected as soon as one drops
+        void connected();
+        void disconnected();
+    private:
+        ClientPool() = default;
+
+        void attach(int index);
+        bool allConnected() const;
+        int leastLoaded() const;
+        int shardOf(const QString& tag) const;
+        QVector<QStringList> shard(const QStringList& tags) const;
+
+        QVector<std::shared_ptr<Client>> _clients;
+        QVector<int> _inFlight;
+        QVector<bool> _connected;
+    };
+}
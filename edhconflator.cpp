@@ -0,0 +1,127 @@
+#include "edhconflator.h"
+#include "edhclient.h"
+
+#include <limits>
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+static qint64 rateToInterval(int updatesPerSecond) {
+    if (updatesPerSecond <= 0) {
+        return 0;
+    }
+    return 1000000 / updatesPerSecond;
+}
+
+UpdateConflator::UpdateConflator(Client *client, QObject *parent) : QObject(parent) {
+    _clock.start();
+    _timer.setSingleShot(true);
+
+    connect(&_timer, &QTimer::timeout, this, &UpdateConflator::flush);
+    connect(client, &Client::tagValueUpdated, this, &UpdateConflator::onTagValueUpdated);
+}
+
+void UpdateConflator::setMaxRate(int updatesPerSecond) {
+    _interval = rateToInterval(updatesPerSecond);
+}
+
+void UpdateConflator::setMaxRate(const QString &tag, int updatesPerSecond) {
+    _tagIntervals.insert(tag, rateToInterval(updatesPerSecond));
+}
+
+void UpdateConflator::setConsumerRate(int updatesPerSecond) {
+    _consumerInterval = rateToInterval(updatesPerSecond);
+}
+
+void UpdateConflator::setMaxPending(int tags) {
+    _maxPending = tags;
+}
+
+qint64 UpdateConflator::interval(const QString &tag) const {
+    return _tagIntervals.value(tag, _interval);
+}
+
+bool UpdateConflator::consumerToken(qint64 now) {
+    if (_consumerInterval == 0) {
+        return true;
+    }
+    if (now < _consumerNext) {
+        return false;
+    }
+
+    _consumerNext = now + _consumerInterval;
+    return true;
+}
+
+void UpdateConflator::deliver(const QString &tag, const Update &update, qint64 now) {
+    _lastDelivery.insert(tag, now);
+    _counters.delivered++;
+    emit tagValueUpdated(tag, update.timestamp, update.metaType, update.value);
+}
+
+void UpdateConflator::onTagValueUpdated(const QString &tagName, const QDateTime &timestamp, QMetaType::Type metaType, const QVariant &variantValue) {
+    _counters.received++;
+
+    auto pending = _pending.find(tagName);
+    if (pending != _pending.end()) {
+        pending->timestamp = timestamp;
+        pending->metaType = metaType;
+        pending->value = variantValue;
+        _counters.conflated++;
+        return;
+    }
+
+    qint64 now = _clock.nsecsElapsed() / 1000;
+    qint64 wait = 0;
+    auto last = _lastDelivery.find(tagName);
+    if (last != _lastDelivery.end()) {
+        wait = last.value() + interval(tagName) - now;
+    }
+
+    Update update{timestamp, metaType, variantValue};
+    if (wait <= 0 && _order.isEmpty() && consumerToken(now)) {
+        deliver(tagName, update, now);
+        return;
+    }
+
+    if (_maxPending > 0 && _pending.size() >= _maxPending) {
+        _counters.dropped++;
+        return;
+    }
+
+    _pending.insert(tagName, update);
+    _order.enqueue(tagName);
+
+    if (! _timer.isActive()) {
+        wait = std::max(wait, _consumerNext - now);
+        _timer.start(int((std::max<qint64>(wait, 0) + 999) / 1000));
+    }
+}
+
+void UpdateConflator::flush() {
+    qint64 now = _clock.nsecsElapsed() / 1000;
+    qint64 nextWait = std::numeric_limits<qint64>::max();
+
+    int n = _order.size();
+    for (int i = 0; i < n; i++) {
+        QString tag = _order.dequeue();
+
+        qint64 wait = 0;
+        auto last = _lastDelivery.find(tag);
+        if (last != _lastDelivery.end()) {
+            wait = last.value() + interval(tag) - now;
+        }
+
+        if (wait > 0 || ! consumerToken(now)) {
+            nextWait = std::min(nextWait, std::max(wait, _consumerNext - now));
+            _order.enqueue(tag);
+            continue;
+        }
+
+        deliver(tag, _pending.take(tag), now);
+    }
+
+    if (! _order.isEmpty()) {
+        _timer.start(int((std::max<qint64>(nextWait, 0) + 999) / 1000));
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QTimer>
+#include <QVariant>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include "edhtypes.h"
+
+namespace eDrillingHub {
+    class Client;
+
+    /**
+     * @brief UpdateConflator - bounds the update rate seen by a slow consumer
+     *
+     * Sits between Client::tagValueUpdated and a consumer. At most one update per tag is kept
+     * pending; a newer value replaces it. Updates are delivered no faster than the per-tag rate,
+     * and no faster than the consumer rate over all tags. Create one conflator per consumer.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC UpdateConflator : public QObject {
+        Q_OBJECT
+    public:
+        struct Counters {
+            quint64 received = 0;
+            quint64 delivered = 0;
+            quint64 conflated = 0;
+            quint64 dropped = 0;
+        };
+
+        UpdateConflator(Client* client, QObject* parent = nullptr);
+
+        // updates per second, 0 is unlimited
+        void setMaxRate(int updatesPerSecond);
+        void setMaxRate(const QString& tag, int updatesPerSecond);
+        void setConsumerRate(int updatesPerSecond);
+
+        // tags with a pending update, further tags are dropped, 0 is unlimited
+        void setMaxPending(int tags);
+
+        Counters counters() const { return _counters; }
+        void resetCounters() { _counters = Counters(); }
+        int pending() const { return _pending.size(); }
+    signals:
+        void tagValueUpdated(const QString& tagName, const QDateTime& timestamp, QMetaType::Type metaType, const QVariant& variantValue);
+
+    private:
+        struct Update {
+            QDateTime timestamp;
+            QMetaType::Type metaType;
+            QVariant value;
+        };
+
+        void onTagValueUpdated(const QString& tagName, const QDateTime& timestamp, QMetaType::Type metaType, const QVariant& variantValue);
+        void flush();
+
+        qint64 interval(const QString& tag) const;
+        bool consumerToken(qint64 now);
+        void deliver(const QString& tag, const Update& update, qint64 now);
+
+        QHash<QString, Update> _pending;
+        QQueue<QString> _order;
+        QHash<QString, qint64> _lastDelivery;
+        QHash<QString, qint64> _tagIntervals;
+
+        qint64 _interval = 0;
+        qint64 _consumerInterval = 0;
+        qint64 _consumerNext = 0;
+        int _maxPending = 0;
+
+        Counters _counters;
+        QElapsedTimer _clock;
+        QTimer _timer;
+    };
+}
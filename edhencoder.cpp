@@ -0,0 +1,304 @@
+#include "edhencoder.h"
+#include "serialization.h"
+
+#include <QMetaEnum>
+
+#include <algorithm>
+#include <tuple>
+
+using namespace eDrillingHub;
+
+static const int encoder_initial_capacity = 1024;
+
+namespace {
+    // the configuration keywords, looked up through QMetaEnum once instead of per command
+    struct ConfigurationKeys {
+        QVector<QByteArray> operations, targets, commands;
+
+        ConfigurationKeys() {
+            fill<ServerConfiguration::Operation>(operations, ServerConfiguration().getOperationPrefix().toLatin1());
+            fill<ServerConfiguration::Target>(targets, QByteArray());
+            fill<ServerConfiguration::Command>(commands, QByteArray());
+        }
+
+        template <typename E>
+        static void fill(QVector<QByteArray>& keys, const QByteArray& prefix) {
+            QMetaEnum e = QMetaEnum::fromType<E>();
+            for (int i = 0; i < e.keyCount(); i++) {
+                int value = e.value(i);
+                if (value < 0) {
+                    continue;
+                }
+                if (value >= keys.size()) {
+                    keys.resize(value + 1);
+                }
+                QByteArray key(e.key(i));
+                if (! prefix.isEmpty() && key.startsWith(prefix)) {
+                    key.remove(0, prefix.size());
+                }
+                keys[value] = key;
+            }
+        }
+
+        static const QByteArray& key(const QVector<QByteArray>& keys, int value) {
+            static const QByteArray none;
+            return value >= 0 && value < keys.size() ? keys[value] : none;
+        }
+    };
+
+    const ConfigurationKeys& configurationKeys() {
+        static const ConfigurationKeys keys;
+        return keys;
+    }
+}
+
+CommandEncoder::CommandEncoder(QByteArray *buffer) :
+    _out(buffer ? buffer : &_own)
+{
+    // a reserved capacity survives resize(0), see clear()
+    _out->reserve(std::max(_out->capacity(), encoder_initial_capacity));
+}
+
+void CommandEncoder::clear() {
+    _out->resize(0);
+    _commands = 0;
+}
+
+CommandEncoder &CommandEncoder::end() {
+    _out->append("\r\n", 2);
+    _commands++;
+    return *this;
+}
+
+void CommandEncoder::appendNumber(QByteArray &out, qint64 value) {
+    char digits[24];
+    int n = 0;
+    quint64 v = value < 0 ? quint64(0) - quint64(value) : quint64(value);
+
+    do {
+        digits[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+
+    if (value < 0) {
+        out.append('-');
+    }
+    while (n > 0) {
+        out.append(digits[--n]);
+    }
+}
+
+void CommandEncoder::appendUtf8(QByteArray &out, const QString &value, bool escape) {
+    const QChar* data = value.constData();
+    int size = value.size();
+
+    for (int i = 0; i < size; i++) {
+        ushort c = data[i].unicode();
+
+        if (c < 0x80) {
+            if (escape) {
+                if (c == '\\') {
+                    out.append("\\\\", 2);
+                    continue;
+                }
+                if (c == '|') {
+                    out.append("\\|", 2);
+                    continue;
+                }
+                if (c == '\r' && i + 1 < size && data[i + 1].unicode() == '\n') {
+                    out.append("\\r\\n", 4);
+                    i++;
+                    continue;
+                }
+            }
+            out.append(char(c));
+        } else if (c < 0x800) {
+            out.append(char(0xc0 | (c >> 6)));
+            out.append(char(0x80 | (c & 0x3f)));
+        } else if (QChar::isHighSurrogate(c) && i + 1 < size && QChar::isLowSurrogate(data[i + 1].unicode())) {
+            uint u = QChar::surrogateToUcs4(c, data[i + 1].unicode());
+            out.append(char(0xf0 | (u >> 18)));
+            out.append(char(0x80 | ((u >> 12) & 0x3f)));
+            out.append(char(0x80 | ((u >> 6) & 0x3f)));
+            out.append(char(0x80 | (u & 0x3f)));
+            i++;
+        } else if (QChar::isSurrogate(c)) {
+            // unpaired surrogate, U+FFFD like QString::toUtf8
+            out.append("\xef\xbf\xbd", 3);
+        } else {
+            out.append(char(0xe0 | (c >> 12)));
+            out.append(char(0x80 | ((c >> 6) & 0x3f)));
+            out.append(char(0x80 | (c & 0x3f)));
+        }
+    }
+}
+
+int CommandEncoder::utf8Size(const QString &value) {
+    const QChar* data = value.constData();
+    int size = value.size();
+    int bytes = 0;
+
+    for (int i = 0; i < size; i++) {
+        ushort c = data[i].unicode();
+
+        if (c < 0x80) {
+            bytes += 1;
+        } else if (c < 0x800) {
+            bytes += 2;
+        } else if (QChar::isHighSurrogate(c) && i + 1 < size && QChar::isLowSurrogate(data[i + 1].unicode())) {
+            bytes += 4;
+            i++;
+        } else {
+            bytes += 3;
+        }
+    }
+    return bytes;
+}
+
+CommandEncoder &CommandEncoder::writeTag(const QString &tag, qint64 timestamp, const QVariant &value) {
+    QMetaType::Type type = static_cast<QMetaType::Type>(value.type());
+
+    _out->append("write|", 6);
+    appendUtf8(*_out, tag);
+    _out->append('|');
+    appendNumber(*_out, timestamp);
+    _out->append('|');
+
+    switch (type) {
+    case QMetaType::Bool:
+        appendNumber(*_out, type);
+        _out->append('|');
+        if (value.toBool()) {
+            _out->append("true", 4);
+        } else {
+            _out->append("false", 5);
+        }
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+        appendNumber(*_out, type);
+        _out->append('|');
+        appendNumber(*_out, value.toLongLong());
+        break;
+    case QMetaType::QDateTime: {
+        appendNumber(*_out, type);
+        _out->append('|');
+        QDateTime dt = value.toDateTime();
+        if (dt.isValid()) {
+            appendNumber(*_out, dt.toMSecsSinceEpoch());
+        }
+    }
+        break;
+    case QMetaType::QString:
+        appendNumber(*_out, type);
+        _out->append('|');
+        appendUtf8(*_out, *reinterpret_cast<const QString*>(value.constData()), true);
+        break;
+#if (QT_VERSION >= QT_VERSION_CHECK(5,7,0))
+    case QMetaType::Double:
+        // the formatting QVariant::toString uses for doubles
+        appendNumber(*_out, type);
+        _out->append('|');
+        _out->append(QByteArray::number(value.toDouble(), 'g', QLocale::FloatingPointShortest));
+        break;
+#endif
+    default: {
+        QString serialized;
+        QMetaType::Type metaType;
+        std::tie(serialized, metaType) = Serialization::serialize(value);
+        appendNumber(*_out, metaType);
+        _out->append('|');
+        appendUtf8(*_out, serialized);
+    }
+        break;
+    }
+
+    return end();
+}
+
+CommandEncoder &CommandEncoder::writeTag(const QString &tag, const QDateTime &timestamp, const QVariant &value) {
+    return writeTag(tag, timestamp.toMSecsSinceEpoch(), value);
+}
+
+CommandEncoder &CommandEncoder::readTag(const QString &tag) {
+    _out->append("read|", 5);
+    appendUtf8(*_out, tag);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::readTagRange(const QString &tag, qint64 from, qint64 to) {
+    _out->append("read|", 5);
+    appendUtf8(*_out, tag);
+    _out->append('|');
+    appendNumber(*_out, from);
+    _out->append('|');
+    appendNumber(*_out, to);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::queryTagRange(const QString &tag) {
+    _out->append("db|range|", 9);
+    appendUtf8(*_out, tag);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::subscribeTag(const QString &tag) {
+    _out->append("subscribe|", 10);
+    appendUtf8(*_out, tag);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::unsubscribeTag(const QString &tag) {
+    _out->append("unsubscribe|", 12);
+    appendUtf8(*_out, tag);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::unsubscribeAll() {
+    _out->append("unsubscribe", 11);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::browse() {
+    _out->append("browse", 6);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::switchSession(const QString &sessionName) {
+    _out->append("session|switch|", 15);
+    appendUtf8(*_out, sessionName);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::configuration(ServerConfiguration::Operation operation, ServerConfiguration::Target target, ServerConfiguration::Command command, const QString &targetTag) {
+    const ConfigurationKeys& keys = configurationKeys();
+
+    _out->append("config|", 7);
+    _out->append(ConfigurationKeys::key(keys.operations, static_cast<int>(operation)));
+    _out->append('|');
+    _out->append(ConfigurationKeys::key(keys.targets, static_cast<int>(target)));
+    _out->append('|');
+    _out->append(ConfigurationKeys::key(keys.commands, static_cast<int>(command)));
+    _out->append('|');
+    appendUtf8(*_out, targetTag);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::fileTransfer(const QString &filename) {
+    _out->append("file|transfer|", 14);
+    appendUtf8(*_out, filename);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::fileUploadRequest(const QString &filename, qint64 size) {
+    _out->append("file|upload|", 12);
+    appendUtf8(*_out, filename);
+    _out->append('|');
+    appendNumber(*_out, size);
+    return end();
+}
+
+CommandEncoder &CommandEncoder::command(const QString &line) {
+    appendUtf8(*_out, line);
+    return end();
+}
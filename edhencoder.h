@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QVariant>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+
+namespace eDrillingHub {
+    /**
+     * @brief CommandEncoder - appends protocol commands as UTF-8 lines into a reusable buffer
+     *
+     * Produces the same bytes as the Protocol functions followed by the line terminator,
+     * without building intermediate strings. Strings are escaped while they are encoded and
+     * the configuration keywords are precomputed. Matrix and vector values go through
+     * Serialization, double values through Qt's shortest round-trip formatting.
+     *
+     * The buffer is either owned by the encoder or provided by the caller, clear() keeps its
+     * capacity so a long-lived encoder stops allocating once it has grown to its working size.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC CommandEncoder {
+    public:
+        explicit CommandEncoder(QByteArray* buffer = nullptr);
+
+        const QByteArray& buffer() const { return *_out; }
+        int commands() const { return _commands; }
+        bool isEmpty() const { return _commands == 0; }
+        void clear();
+
+        CommandEncoder& writeTag(const QString& tag, qint64 timestamp, const QVariant& value);
+        CommandEncoder& writeTag(const QString& tag, const QDateTime& timestamp, const QVariant& value);
+        CommandEncoder& readTag(const QString& tag);
+        CommandEncoder& readTagRange(const QString& tag, qint64 from, qint64 to);
+        CommandEncoder& queryTagRange(const QString& tag);
+        CommandEncoder& subscribeTag(const QString& tag);
+        CommandEncoder& unsubscribeTag(const QString& tag);
+        CommandEncoder& unsubscribeAll();
+        CommandEncoder& browse();
+        CommandEncoder& switchSession(const QString& sessionName);
+        CommandEncoder& configuration(ServerConfiguration::Operation operation, ServerConfiguration::Target target, ServerConfiguration::Command command, const QString& targetTag);
+        CommandEncoder& fileTransfer(const QString& filename);
+        CommandEncoder& fileUploadRequest(const QString& filename, qint64 size);
+
+        // raw text, appended verbatim as one command
+        CommandEncoder& command(const QString& line);
+
+        static void appendUtf8(QByteArray& out, const QString& value, bool escape = false);
+        static void appendNumber(QByteArray& out, qint64 value);
+        // bytes appendUtf8 produces for value without escaping
+        static int utf8Size(const QString& value);
+
+    private:
+        // _out may point at _own
+        Q_DISABLE_COPY(CommandEncoder)
+
+        CommandEncoder& end();
+
+        QByteArray _own;
+        QByteArray* _out;
+        int _commands = 0;
+    };
+}
@@ -0,0 +1,597 @@
+#include "edhhistorycache.h"
+#include "edhclient.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QDebug>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+using namespace eDrillingHub;
+
+static const quint32 cache_magic = 0x43484445; // "EDHC"
+static const quint32 cache_version = 1;
+static const qint64 cache_header_size = 16;
+static const qint64 cache_initial_capacity = 1024;
+
+namespace eDrillingHub {
+    struct HistoryCacheRecord {
+        qint64 timestamp;
+        qint32 type;
+        qint32 reserved;
+        qint64 bits;
+    };
+
+    /*
+     * On-disk layout: a 16 byte header (magic, version, record count) followed by
+     * fixed-width records sorted on timestamp. The file is kept larger than the
+     * record count so appends are plain stores into the mapping; the count is only
+     * bumped after the record is written, so a torn append is simply not visible.
+     */
+    struct HistoryCacheFile {
+        QString tag;
+        QFile data;
+        QString indexPath;
+        uchar* map = nullptr;
+        qint64 capacity = 0;
+        bool cacheable = true;
+        bool dirty = false;
+        QVector<QPair<qint64, qint64>> coverage;
+
+        ~HistoryCacheFile() {
+            if (dirty) {
+                saveIndex();
+            }
+            if (map) {
+                data.unmap(map);
+            }
+        }
+
+        bool open() {
+            if (! data.open(QIODevice::ReadWrite)) {
+                qWarning() << "HistoryCache: unable to open" << data.fileName() << data.errorString();
+                return false;
+            }
+
+            bool fresh = data.size() < cache_header_size;
+            if (fresh && ! data.resize(cache_header_size + cache_initial_capacity * qint64(sizeof(HistoryCacheRecord)))) {
+                return false;
+            }
+            if (! remap()) {
+                return false;
+            }
+
+            if (fresh) {
+                std::memcpy(map, &cache_magic, sizeof(cache_magic));
+                std::memcpy(map + 4, &cache_version, sizeof(cache_version));
+                setCount(0);
+            } else if (std::memcmp(map, &cache_magic, sizeof(cache_magic)) != 0) {
+                qWarning() << "HistoryCache: invalid cache file" << data.fileName();
+                return false;
+            } else if (count() > capacity) {
+                setCount(capacity);
+            }
+
+            loadIndex();
+            return true;
+        }
+
+        // a file whose mapping is lost is left alone, see usable()
+        bool remap() {
+            if (map) {
+                data.unmap(map);
+            }
+            map = data.map(0, data.size());
+            if (! map) {
+                qWarning() << "HistoryCache: unable to map" << data.fileName() << data.errorString();
+                capacity = 0;
+                return false;
+            }
+            capacity = (data.size() - cache_header_size) / qint64(sizeof(HistoryCacheRecord));
+            return true;
+        }
+
+        bool usable() const {
+            return map && cacheable;
+        }
+
+        bool reserve(qint64 n) {
+            if (n <= capacity) {
+                return true;
+            }
+
+            qint64 newCapacity = std::max(n, capacity * 2);
+            if (map) {
+                data.unmap(map);
+                map = nullptr;
+            }
+            if (! data.resize(cache_header_size + newCapacity * qint64(sizeof(HistoryCacheRecord)))) {
+                qWarning() << "HistoryCache: unable to grow" << data.fileName() << data.errorString();
+                remap();
+                return false;
+            }
+            return remap();
+        }
+
+        qint64 count() const {
+            qint64 c;
+            std::memcpy(&c, map + 8, sizeof(c));
+            return c;
+        }
+
+        void setCount(qint64 c) {
+            std::memcpy(map + 8, &c, sizeof(c));
+        }
+
+        HistoryCacheRecord* records() const {
+            return reinterpret_cast<HistoryCacheRecord*>(map + cache_header_size);
+        }
+
+        qint64 lowerBound(qint64 ts) const {
+            auto begin = records();
+            auto it = std::lower_bound(begin, begin + count(), ts, [](const HistoryCacheRecord& r, qint64 ts) {
+                return r.timestamp < ts;
+            });
+            return it - begin;
+        }
+
+        qint64 upperBound(qint64 ts) const {
+            auto begin = records();
+            auto it = std::upper_bound(begin, begin + count(), ts, [](qint64 ts, const HistoryCacheRecord& r) {
+                return ts < r.timestamp;
+            });
+            return it - begin;
+        }
+
+        bool append(const HistoryCacheRecord& record) {
+            qint64 c = count();
+            if (! reserve(c + 1)) {
+                return false;
+            }
+            records()[c] = record;
+            setCount(c + 1);
+            return true;
+        }
+
+        // Replaces everything stored in [from, to] by the (sorted) records
+        bool replace(qint64 from, qint64 to, const QVector<HistoryCacheRecord>& replacement) {
+            qint64 start = lowerBound(from);
+            qint64 end = upperBound(to);
+            qint64 c = count();
+
+            QVector<HistoryCacheRecord> tail(int(c - end));
+            if (! tail.isEmpty()) {
+                std::memcpy(tail.data(), records() + end, size_t(tail.size()) * sizeof(HistoryCacheRecord));
+            }
+
+            qint64 newCount = start + replacement.size() + tail.size();
+            if (! reserve(newCount)) {
+                return false;
+            }
+
+            // hide everything from start on before overwriting it, a crash leaves the sorted prefix
+            setCount(start);
+            if (! replacement.isEmpty()) {
+                std::memcpy(records() + start, replacement.constData(), size_t(replacement.size()) * sizeof(HistoryCacheRecord));
+            }
+            if (! tail.isEmpty()) {
+                std::memcpy(records() + start + replacement.size(), tail.constData(), size_t(tail.size()) * sizeof(HistoryCacheRecord));
+            }
+            setCount(newCount);
+            return true;
+        }
+
+        void cover(qint64 from, qint64 to) {
+            if (from > to) {
+                return;
+            }
+
+            QVector<QPair<qint64, qint64>> merged;
+            merged.reserve(coverage.size() + 1);
+            bool inserted = false;
+            for (const auto& interval : coverage) {
+                if (interval.second + 1 < from) {
+                    merged.append(interval);
+                } else if (to + 1 < interval.first) {
+                    if (! inserted) {
+                        merged.append(qMakePair(from, to));
+                        inserted = true;
+                    }
+                    merged.append(interval);
+                } else {
+                    from = std::min(from, interval.first);
+                    to = std::max(to, interval.second);
+                }
+            }
+            if (! inserted) {
+                merged.append(qMakePair(from, to));
+            }
+
+            coverage = merged;
+            dirty = true;
+        }
+
+        QVector<QPair<qint64, qint64>> gaps(qint64 from, qint64 to) const {
+            QVector<QPair<qint64, qint64>> result;
+            qint64 cursor = from;
+            for (const auto& interval : coverage) {
+                if (interval.second < cursor) {
+                    continue;
+                }
+                if (interval.first > to) {
+                    break;
+                }
+                if (interval.first > cursor) {
+                    result.append(qMakePair(cursor, interval.first - 1));
+                }
+                cursor = interval.second + 1;
+                if (cursor > to) {
+                    break;
+                }
+            }
+            if (cursor <= to) {
+                result.append(qMakePair(cursor, to));
+            }
+            return result;
+        }
+
+        void loadIndex() {
+            QFile index(indexPath);
+            if (! index.open(QIODevice::ReadOnly)) {
+                return;
+            }
+
+            QDataStream s(&index);
+            quint32 version;
+            QString storedTag;
+            s >> version;
+            if (version != cache_version) {
+                return;
+            }
+            s >> storedTag >> cacheable >> coverage;
+            if (s.status() != QDataStream::Ok || storedTag != tag) {
+                qWarning() << "HistoryCache: discarding corrupt index" << indexPath;
+                cacheable = true;
+                coverage.clear();
+            }
+        }
+
+        void saveIndex() {
+            QSaveFile index(indexPath);
+            if (! index.open(QIODevice::WriteOnly)) {
+                qWarning() << "HistoryCache: unable to write" << indexPath << index.errorString();
+                return;
+            }
+
+            QDataStream s(&index);
+            s << cache_version << tag << cacheable << coverage;
+            if (index.commit()) {
+                dirty = false;
+            }
+        }
+    };
+}
+
+static bool encodeCacheValue(const QVariant& value, HistoryCacheRecord& record) {
+    record.type = value.userType();
+    record.reserved = 0;
+
+    switch (record.type) {
+    case QMetaType::Double: {
+        double d = value.toDouble();
+        std::memcpy(&record.bits, &d, sizeof(d));
+        return true;
+    }
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Bool:
+        record.bits = value.toLongLong();
+        return true;
+    case QMetaType::QDateTime:
+        record.bits = value.toDateTime().toMSecsSinceEpoch();
+        return true;
+    default:
+        return false;
+    }
+}
+
+static QVariant decodeCacheValue(const HistoryCacheRecord& record) {
+    switch (record.type) {
+    case QMetaType::Double: {
+        double d;
+        std::memcpy(&d, &record.bits, sizeof(d));
+        return QVariant(d);
+    }
+    case QMetaType::Int:
+        return QVariant(static_cast<int>(record.bits));
+    case QMetaType::LongLong:
+        return QVariant(static_cast<qint64>(record.bits));
+    case QMetaType::Bool:
+        return QVariant(record.bits != 0);
+    case QMetaType::QDateTime:
+        return QVariant(QDateTime::fromMSecsSinceEpoch(record.bits, Qt::UTC));
+    default:
+        return QVariant();
+    }
+}
+
+HistoryCache::HistoryCache(Client *client, const QString &directory) :
+    _client(client),
+    _directory(directory)
+{
+    QDir().mkpath(_directory);
+
+    connect(_client, &Client::tagRead, this, &HistoryCache::onTagRead);
+    connect(_client, &Client::tagReadFailed, this, &HistoryCache::onTagReadFailed);
+    connect(_client, &Client::tagValueUpdated, this, &HistoryCache::onTagValueUpdated);
+    connect(_client, &Client::disconnected, this, [this] {
+        _liveSince.clear();
+        _requested.clear();
+    });
+}
+
+HistoryCache::~HistoryCache() {
+}
+
+HistoryCacheFile* HistoryCache::file(const QString &tag) {
+    auto it = _files.find(tag);
+    if (it != _files.end()) {
+        // unmapped after a failed resize, not used again until reopened
+        return it->get()->map ? it->get() : nullptr;
+    }
+
+    QString name = QString(QCryptographicHash::hash(tag.toUtf8(), QCryptographicHash::Sha1).toHex());
+    auto f = std::make_shared<HistoryCacheFile>();
+    f->tag = tag;
+    f->data.setFileName(QDir(_directory).filePath(name + ".edhc"));
+    f->indexPath = QDir(_directory).filePath(name + ".idx");
+    if (! f->open()) {
+        return nullptr;
+    }
+
+    _files.insert(tag, f);
+    return f.get();
+}
+
+bool HistoryCache::covers(const QString &tag, qint64 from, qint64 to) {
+    auto f = file(tag);
+    return f && f->usable() && f->gaps(from, to).isEmpty();
+}
+
+void HistoryCache::clear(const QString &tag) {
+    auto f = file(tag);
+    if (! f) {
+        return;
+    }
+
+    f->setCount(0);
+    f->coverage.clear();
+    f->cacheable = true;
+    f->saveIndex();
+}
+
+void HistoryCache::readTagRange(const QString &tag, const QDateTime &from, const QDateTime &to) {
+    qint64 msFrom = from.toMSecsSinceEpoch();
+    qint64 msTo = to.toMSecsSinceEpoch();
+
+    PendingRead pending;
+    pending.from = msFrom;
+    pending.to = msTo;
+
+    auto f = file(tag);
+    if (! f || ! f->usable()) {
+        pending.passthrough = true;
+        pending.gaps.append(qMakePair(msFrom, msTo));
+    } else {
+        pending.gaps = f->gaps(msFrom, msTo);
+        if (pending.gaps.isEmpty()) {
+            QTimer::singleShot(0, this, [this, tag, msFrom, msTo] {
+                serve(tag, msFrom, msTo);
+            });
+            return;
+        }
+    }
+
+    _pending[tag].append(pending);
+    for (const auto& gap : pending.gaps) {
+        request(tag, gap.first, gap.second);
+    }
+}
+
+void HistoryCache::request(const QString &tag, qint64 from, qint64 to) {
+    _requested[tag].append(qMakePair(from, to));
+    _client->readTagRange(tag, QDateTime::fromMSecsSinceEpoch(from, Qt::UTC), QDateTime::fromMSecsSinceEpoch(to, Qt::UTC));
+}
+
+void HistoryCache::serve(const QString &tag, qint64 from, qint64 to) {
+    auto f = file(tag);
+    if (! f) {
+        PendingRead pending;
+        pending.from = from;
+        pending.to = to;
+        pending.passthrough = true;
+        pending.gaps.append(qMakePair(from, to));
+        _pending[tag].append(pending);
+        request(tag, from, to);
+        return;
+    }
+
+    ReadTagHolder holder;
+    holder.from = QDateTime::fromMSecsSinceEpoch(from, Qt::UTC);
+    holder.to = QDateTime::fromMSecsSinceEpoch(to, Qt::UTC);
+
+    qint64 begin = f->lowerBound(from);
+    qint64 end = f->upperBound(to);
+    holder.timestamps.reserve(int(end - begin));
+    holder.values.reserve(int(end - begin));
+
+    const HistoryCacheRecord* records = f->records();
+    for (qint64 i = begin; i < end; i++) {
+        holder.timestamps.append(QDateTime::fromMSecsSinceEpoch(records[i].timestamp, Qt::UTC));
+        holder.values.append(decodeCacheValue(records[i]));
+    }
+
+    emit tagRead(tag, holder);
+}
+
+void HistoryCache::store(HistoryCacheFile *f, const ReadTagHolder &data) {
+    qint64 from = data.from.toMSecsSinceEpoch();
+    qint64 to = data.to.toMSecsSinceEpoch();
+
+    QVector<HistoryCacheRecord> records;
+    records.reserve(data.values.size());
+    for (int i = 0; i < data.values.size() && i < data.timestamps.size(); i++) {
+        HistoryCacheRecord record;
+        record.timestamp = data.timestamps[i].toMSecsSinceEpoch();
+        if (! encodeCacheValue(data.values[i], record)) {
+            f->cacheable = false;
+            f->coverage.clear();
+            f->saveIndex();
+            return;
+        }
+        records.append(record);
+    }
+
+    std::stable_sort(records.begin(), records.end(), [](const HistoryCacheRecord& a, const HistoryCacheRecord& b) {
+        return a.timestamp < b.timestamp;
+    });
+    if (! f->replace(from, to, records)) {
+        return;
+    }
+
+    // the server may still receive samples for the open end of the window
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (to > now) {
+        to = records.isEmpty() ? from - 1 : records.last().timestamp;
+    }
+    f->cover(from, to);
+    f->saveIndex();
+}
+
+void HistoryCache::onTagRead(const QString &tag, const ReadTagHolder &data) {
+    qint64 from = data.from.toMSecsSinceEpoch();
+    qint64 to = data.to.toMSecsSinceEpoch();
+
+    // replies to reads other callers issued are none of the cache's business
+    auto requested = _requested.find(tag);
+    if (requested == _requested.end() || ! requested.value().removeOne(qMakePair(from, to))) {
+        return;
+    }
+    if (requested.value().isEmpty()) {
+        _requested.erase(requested);
+    }
+
+    auto f = file(tag);
+    if (f && f->usable()) {
+        store(f, data);
+    }
+
+    auto it = _pending.find(tag);
+    if (it == _pending.end()) {
+        return;
+    }
+
+    auto& pendingReads = it.value();
+    for (int i = 0; i < pendingReads.size(); i++) {
+        auto& pending = pendingReads[i];
+        int gap = pending.gaps.indexOf(qMakePair(from, to));
+        if (gap < 0) {
+            continue;
+        }
+
+        pending.gaps.remove(gap);
+        if (pending.passthrough) {
+            emit tagRead(tag, data);
+            pendingReads.removeAt(i);
+        } else if (pending.gaps.isEmpty()) {
+            PendingRead done = pendingReads.takeAt(i);
+            if (f && f->usable()) {
+                serve(tag, done.from, done.to);
+            } else if (done.from == from && done.to == to) {
+                emit tagRead(tag, data);
+            } else {
+                done.passthrough = true;
+                done.gaps.append(qMakePair(done.from, done.to));
+                pendingReads.append(done);
+                request(tag, done.from, done.to);
+            }
+        }
+        break;
+    }
+
+    if (pendingReads.isEmpty()) {
+        _pending.erase(it);
+    }
+}
+
+void HistoryCache::onTagReadFailed(const QString &tag, const QDateTime &from, const QDateTime &to) {
+    QPair<qint64, qint64> gap(from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch());
+
+    auto requested = _requested.find(tag);
+    if (requested == _requested.end() || ! requested.value().removeOne(gap)) {
+        return;
+    }
+    if (requested.value().isEmpty()) {
+        _requested.erase(requested);
+    }
+
+    auto it = _pending.find(tag);
+    if (it == _pending.end()) {
+        return;
+    }
+
+    // the reads waiting on the gap fail as a whole, gaps already answered stay cached
+    QList<PendingRead> failed;
+    auto& pendingReads = it.value();
+    for (int i = pendingReads.size() - 1; i >= 0; i--) {
+        if (pendingReads[i].gaps.contains(gap)) {
+            failed.prepend(pendingReads.takeAt(i));
+        }
+    }
+    if (pendingReads.isEmpty()) {
+        _pending.erase(it);
+    }
+
+    for (const auto& pending : failed) {
+        emit tagReadFailed(tag, QDateTime::fromMSecsSinceEpoch(pending.from, Qt::UTC), QDateTime::fromMSecsSinceEpoch(pending.to, Qt::UTC));
+    }
+}
+
+void HistoryCache::onTagValueUpdated(const QString &tag, const QDateTime &timestamp, QMetaType::Type metaType, const QVariant &value) {
+    Q_UNUSED(metaType)
+
+    auto it = _files.find(tag);
+    if (it == _files.end()) {
+        return;
+    }
+
+    auto f = it->get();
+    if (! f->usable()) {
+        return;
+    }
+
+    HistoryCacheRecord record;
+    record.timestamp = timestamp.toMSecsSinceEpoch();
+    if (! encodeCacheValue(value, record)) {
+        return;
+    }
+
+    qint64 c = f->count();
+    if (c > 0 && f->records()[c - 1].timestamp >= record.timestamp) {
+        return;
+    }
+    if (! f->append(record)) {
+        return;
+    }
+
+    auto since = _liveSince.find(tag);
+    if (since == _liveSince.end()) {
+        since = _liveSince.insert(tag, record.timestamp);
+    }
+    f->cover(since.value(), record.timestamp);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <memory>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+
+namespace eDrillingHub {
+    class Client;
+    struct HistoryCacheFile;
+
+    /**
+     * @brief HistoryCache - persistent, memory-mapped cache in front of Protocol::ReadTagRange
+     *
+     * Every tag read through the cache gets a file of fixed-width, time-sorted samples and
+     * a list of intervals known to be complete. Reads are served from the mapped file where
+     * the interval is covered; only the missing sub-intervals are requested from the server.
+     * Live subscription updates for cached tags are appended, assuming the subscription
+     * delivers every sample the server stores.
+     *
+     * Only scalar numeric types (double, int, qint64, bool, QDateTime) are cached, other
+     * tags are passed straight through to the server.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC HistoryCache : public QObject {
+        Q_OBJECT
+    public:
+        HistoryCache(Client* client, const QString& directory);
+        virtual ~HistoryCache();
+
+        void readTagRange(const QString& tag, const QDateTime& from, const QDateTime& to);
+
+        bool covers(const QString& tag, qint64 from, qint64 to);
+        void clear(const QString& tag);
+    signals:
+        void tagRead(const QString& tag, const ReadTagHolder& data);
+        // the connection dropped a server read the requested interval depends on
+        void tagReadFailed(const QString& tag, const QDateTime& from, const QDateTime& to);
+
+    private:
+        struct PendingRead {
+            qint64 from, to;
+            QVector<QPair<qint64, qint64>> gaps;
+            bool passthrough = false;
+        };
+
+        HistoryCacheFile* file(const QString& tag);
+        void store(HistoryCacheFile* f, const ReadTagHolder& data);
+
+        void onTagRead(const QString& tag, const ReadTagHolder& data);
+        void onTagReadFailed(const QString& tag, const QDateTime& from, const QDateTime& to);
+        void onTagValueUpdated(const QString& tag, const QDateTime& timestamp, QMetaType::Type metaType, const QVariant& value);
+
+        void serve(const QString& tag, qint64 from, qint64 to);
+        void request(const QString& tag, qint64 from, qint64 to);
+
+        Client* _client;
+        QString _directory;
+        QHash<QString, std::shared_ptr<HistoryCacheFile>> _files;
+        QHash<QString, QList<PendingRead>> _pending;
+        // intervals requested from the server and not answered yet
+        QHash<QString, QList<QPair<qint64, qint64>>> _requested;
+        QHash<QString, qint64> _liveSince;
+    };
+}
@@ -0,0 +1,711 @@
+#include "edhjournal.h"
+#include "edhclient.h"
+#include "serialization.h"
+
+#include <limits>
+#include <cstring>
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QDebug>
+#include <QSaveFile>
+#include <QDataStream>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+using namespace eDrillingHub;
+
+static const quint32 journal_magic = 0x4a484445; // "EDHJ"
+static const quint32 journal_version = 1;
+static const qint64 journal_header_size = 16;
+static const qint64 journal_default_segment_size = 64 * 1024 * 1024;
+static const quint32 journal_index_version = 1;
+// one sparse index entry per this many samples of a tag in a segment
+static const int journal_index_stride = 128;
+
+enum JournalRecordKind : quint16 {
+    JournalUnused = 0,
+    JournalTagName = 1,
+    JournalUnit = 2,
+    JournalScalar = 3,
+    JournalText = 4
+};
+
+/*
+ * Records are 8 byte aligned: a 32 byte header followed by the payload. The checksum
+ * covers everything after itself, a record that fails it ends the segment.
+ * Scalar records have an 8 byte payload, tag name, unit and text records carry UTF-8.
+ */
+struct JournalRecordHeader {
+    quint32 checksum;
+    quint16 kind;
+    quint16 type;
+    quint32 tagId;
+    quint32 size;
+    qint64 timestamp;
+    qint32 quality;
+    qint32 reserved;
+};
+static_assert(sizeof(JournalRecordHeader) == 32, "journal record header must be 32 bytes");
+
+static qint64 recordSpan(quint32 size) {
+    return (qint64(sizeof(JournalRecordHeader)) + size + 7) & ~qint64(7);
+}
+
+// FNV-1a, cheap enough for every append and strong enough to spot a torn record
+static quint32 checksum(const uchar* data, qint64 size) {
+    quint32 hash = 2166136261u;
+    for (qint64 i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+namespace eDrillingHub {
+    struct TagJournalSegment {
+        // where the samples of one tag sit in the segment
+        struct TagIndex {
+            quint32 id = 0;
+            qint64 count = 0;
+            qint64 first = std::numeric_limits<qint64>::max();
+            qint64 last = std::numeric_limits<qint64>::min();
+            // false once a sample arrived older than one before it, reads then scan the whole run
+            bool ordered = true;
+            // timestamp and offset of every journal_index_stride-th sample, starting with the first
+            QVector<QPair<qint64, qint64>> sparse;
+            // offset and unit of every unit record
+            QVector<QPair<qint64, QString>> units;
+
+            void add(qint64 timestamp, qint64 offset) {
+                if (count > 0 && timestamp < last) {
+                    ordered = false;
+                }
+                if (count % journal_index_stride == 0) {
+                    sparse.append(qMakePair(timestamp, offset));
+                }
+                count++;
+                first = std::min(first, timestamp);
+                last = std::max(last, timestamp);
+            }
+        };
+
+        qint64 sequence = 0;
+        QFile file;
+        uchar* map = nullptr;
+        qint64 size = 0;
+        qint64 end = journal_header_size;
+        qint64 last = std::numeric_limits<qint64>::min();
+        // the index is on disk and the segment no longer changes
+        bool sealed = false;
+        QHash<quint32, QString> names;
+        QHash<QString, TagIndex> tags;
+
+        ~TagJournalSegment() {
+            if (map) {
+                file.unmap(map);
+            }
+        }
+
+        bool open(qint64 newSize) {
+            if (! file.open(QIODevice::ReadWrite)) {
+                qWarning() << "TagJournal: unable to open" << file.fileName() << file.errorString();
+                return false;
+            }
+
+            bool fresh = file.size() < journal_header_size;
+            if (fresh && ! file.resize(newSize)) {
+                qWarning() << "TagJournal: unable to size" << file.fileName() << file.errorString();
+                return false;
+            }
+
+            size = file.size();
+            map = file.map(0, size);
+            if (! map) {
+                qWarning() << "TagJournal: unable to map" << file.fileName() << file.errorString();
+                return false;
+            }
+
+            if (fresh) {
+                std::memcpy(map, &journal_magic, sizeof(journal_magic));
+                std::memcpy(map + 4, &journal_version, sizeof(journal_version));
+                std::memcpy(map + 8, &sequence, sizeof(sequence));
+            } else if (std::memcmp(map, &journal_magic, sizeof(journal_magic)) != 0) {
+                qWarning() << "TagJournal: invalid segment" << file.fileName();
+                return false;
+            }
+            return true;
+        }
+
+        // the tail past end is only preallocated space, give it back
+        void shrink() {
+            if (! map) {
+                return;
+            }
+            file.unmap(map);
+            map = nullptr;
+            file.resize(end);
+            size = end;
+            map = file.map(0, size);
+        }
+
+        QString indexPath() const {
+            QFileInfo info(file.fileName());
+            return info.dir().filePath(info.completeBaseName() + ".edhx");
+        }
+
+        /*
+         * The index of a sealed segment is kept next to it, so open() only scans segments
+         * that were being appended to when the process stopped. It is only trusted for a
+         * segment of exactly the size it was written for.
+         */
+        bool loadIndex() {
+            QFile index(indexPath());
+            if (! index.open(QIODevice::ReadOnly)) {
+                return false;
+            }
+
+            QDataStream s(&index);
+            quint32 version;
+            qint64 storedSequence, storedEnd;
+            quint32 tagCount;
+            s >> version;
+            if (version != journal_index_version) {
+                return false;
+            }
+            s >> storedSequence >> storedEnd >> tagCount;
+            if (s.status() != QDataStream::Ok || storedSequence != sequence || storedEnd != size) {
+                return false;
+            }
+
+            QHash<QString, TagIndex> loaded;
+            for (quint32 i = 0; i < tagCount && s.status() == QDataStream::Ok; i++) {
+                QString tag;
+                TagIndex idx;
+                s >> tag >> idx.id >> idx.count >> idx.first >> idx.last >> idx.ordered >> idx.sparse >> idx.units;
+                loaded.insert(tag, idx);
+            }
+            if (s.status() != QDataStream::Ok) {
+                qWarning() << "TagJournal: discarding corrupt index" << index.fileName();
+                return false;
+            }
+
+            tags = loaded;
+            end = storedEnd;
+            for (auto it = tags.cbegin(); it != tags.cend(); ++it) {
+                names.insert(it->id, it.key());
+                last = std::max(last, it->last);
+            }
+            sealed = true;
+            return true;
+        }
+
+        void saveIndex() {
+            QSaveFile index(indexPath());
+            if (! index.open(QIODevice::WriteOnly)) {
+                qWarning() << "TagJournal: unable to write" << index.fileName() << index.errorString();
+                return;
+            }
+
+            QDataStream s(&index);
+            s << journal_index_version << sequence << end << quint32(tags.size());
+            for (auto it = tags.cbegin(); it != tags.cend(); ++it) {
+                s << it.key() << it->id << it->count << it->first << it->last << it->ordered << it->sparse << it->units;
+            }
+            if (index.commit()) {
+                sealed = true;
+            }
+        }
+
+        // no more appends: trims the preallocated tail and stores the index
+        void seal() {
+            shrink();
+            if (! sealed && end > journal_header_size) {
+                saveIndex();
+            }
+        }
+    };
+}
+
+static Tag::Value decodeRecord(const JournalRecordHeader& header, const char* payload) {
+    Tag::Value v;
+    v.timestamp(header.timestamp);
+    v.quality(static_cast<Tag::Quality::Value>(header.quality));
+
+    if (header.kind == JournalScalar) {
+        qint64 bits;
+        std::memcpy(&bits, payload, sizeof(bits));
+        switch (header.type) {
+        case QMetaType::Double: {
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            v.value(QVariant(d));
+        }
+            break;
+        case QMetaType::Int:
+            v.value(QVariant(static_cast<int>(bits)));
+            break;
+        case QMetaType::LongLong:
+            v.value(QVariant(bits));
+            break;
+        case QMetaType::Bool:
+            v.value(QVariant(bits != 0));
+            break;
+        case QMetaType::QDateTime:
+            v.value(QVariant(QDateTime::fromMSecsSinceEpoch(bits, Qt::UTC)));
+            break;
+        }
+    } else {
+        v.value(Serialization::deserializeTagValue(static_cast<QMetaType::Type>(header.type), QString::fromUtf8(payload, int(header.size))));
+    }
+    return v;
+}
+
+// walks the records of one segment from the sparse entry at or before from
+static void readSegment(const TagJournalSegment* segment, const TagJournalSegment::TagIndex& idx, qint64 from, qint64 to, QVector<Tag::Value>& result) {
+    qint64 offset = idx.sparse.first().second;
+    if (idx.ordered) {
+        auto it = std::lower_bound(idx.sparse.begin(), idx.sparse.end(), from, [](const QPair<qint64, qint64>& e, qint64 ts) {
+            return e.first < ts;
+        });
+        if (it != idx.sparse.begin()) {
+            --it;
+        }
+        offset = it->second;
+    }
+
+    // the unit in effect where the walk starts, unit records on the way update it
+    QString unit;
+    auto u = std::upper_bound(idx.units.begin(), idx.units.end(), offset, [](qint64 o, const QPair<qint64, QString>& e) {
+        return o < e.first;
+    });
+    if (u != idx.units.begin()) {
+        unit = (u - 1)->second;
+    }
+
+    while (offset + qint64(sizeof(JournalRecordHeader)) <= segment->end) {
+        JournalRecordHeader header;
+        const uchar* record = segment->map + offset;
+        std::memcpy(&header, record, sizeof(header));
+        if (header.kind == JournalUnused) {
+            break;
+        }
+        offset += recordSpan(header.size);
+        if (header.tagId != idx.id) {
+            continue;
+        }
+
+        const char* payload = reinterpret_cast<const char*>(record + sizeof(header));
+        if (header.kind == JournalUnit) {
+            unit = QString::fromUtf8(payload, int(header.size));
+        } else if (header.kind == JournalScalar || header.kind == JournalText) {
+            if (header.timestamp > to) {
+                if (idx.ordered) {
+                    break;
+                }
+                continue;
+            }
+            if (header.timestamp >= from) {
+                Tag::Value v = decodeRecord(header, payload);
+                v.unit(unit);
+                result.append(v);
+            }
+        }
+    }
+}
+
+TagJournal::TagJournal(const QString &directory, QObject *parent) :
+    QObject(parent),
+    _directory(directory),
+    _segmentSize(journal_default_segment_size)
+{
+}
+
+TagJournal::~TagJournal() {
+    close();
+}
+
+void TagJournal::setSegmentSize(qint64 bytes) {
+    _segmentSize = std::max<qint64>(bytes, 4096);
+}
+
+bool TagJournal::open() {
+    if (_open) {
+        return true;
+    }
+    if (! QDir().mkpath(_directory)) {
+        qWarning() << "TagJournal: unable to create" << _directory;
+        return false;
+    }
+
+    QDir dir(_directory);
+    QStringList files = dir.entryList(QStringList() << "*.edhj", QDir::Files, QDir::Name);
+    for (const QString& name : files) {
+        bool ok;
+        qint64 sequence = QFileInfo(name).baseName().toLongLong(&ok);
+        if (! ok) {
+            continue;
+        }
+
+        std::unique_ptr<TagJournalSegment> segment(new TagJournalSegment);
+        segment->sequence = sequence;
+        segment->file.setFileName(dir.filePath(name));
+        if (! segment->open(_segmentSize)) {
+            continue;
+        }
+        if (! segment->loadIndex()) {
+            if (! recover(segment.get())) {
+                continue;
+            }
+            segment->seal();
+        }
+        if (segment->end == journal_header_size) {
+            QString index = segment->indexPath();
+            segment.reset();
+            QFile::remove(dir.filePath(name));
+            QFile::remove(index);
+            continue;
+        }
+        _segments.push_back(std::move(segment));
+    }
+
+    std::sort(_segments.begin(), _segments.end(), [](const std::unique_ptr<TagJournalSegment>& a, const std::unique_ptr<TagJournalSegment>& b) {
+        return a->sequence < b->sequence;
+    });
+    for (const auto& segment : _segments) {
+        for (auto it = segment->tags.cbegin(); it != segment->tags.cend(); ++it) {
+            if (! it->units.isEmpty()) {
+                _units.insert(it.key(), it->units.last().second);
+            }
+        }
+    }
+
+    // appends always start a fresh segment, recovered ones are only read
+    if (! roll()) {
+        _segments.clear();
+        _units.clear();
+        return false;
+    }
+    _open = true;
+    return true;
+}
+
+void TagJournal::close() {
+    if (! _open) {
+        return;
+    }
+
+    if (! _segments.empty()) {
+        _segments.back()->seal();
+    }
+    _segments.clear();
+    _ids.clear();
+    _units.clear();
+    _open = false;
+}
+
+bool TagJournal::recover(TagJournalSegment *segment) {
+    qint64 offset = journal_header_size;
+    bool torn = false;
+
+    while (offset + qint64(sizeof(JournalRecordHeader)) <= segment->size) {
+        JournalRecordHeader header;
+        std::memcpy(&header, segment->map + offset, sizeof(header));
+
+        if (header.kind == JournalUnused) {
+            break;
+        }
+        if (header.kind > JournalText || offset + recordSpan(header.size) > segment->size ||
+                checksum(segment->map + offset + 4, qint64(sizeof(header)) - 4 + header.size) != header.checksum) {
+            torn = true;
+            break;
+        }
+
+        const char* payload = reinterpret_cast<const char*>(segment->map + offset + sizeof(header));
+        switch (header.kind) {
+        case JournalTagName: {
+            QString tag = QString::fromUtf8(payload, int(header.size));
+            segment->names.insert(header.tagId, tag);
+            segment->tags[tag].id = header.tagId;
+        }
+            break;
+        case JournalUnit:
+            segment->tags[segment->names.value(header.tagId)].units.append(qMakePair(offset, QString::fromUtf8(payload, int(header.size))));
+            break;
+        default:
+            segment->tags[segment->names.value(header.tagId)].add(header.timestamp, offset);
+            segment->last = std::max(segment->last, header.timestamp);
+            break;
+        }
+
+        offset += recordSpan(header.size);
+    }
+
+    if (torn) {
+        qWarning() << "TagJournal: dropping torn records after offset" << offset << "in" << segment->file.fileName();
+    }
+
+    segment->end = offset;
+    segment->shrink();
+    return segment->map != nullptr;
+}
+
+bool TagJournal::roll() {
+    if (! _segments.empty()) {
+        _segments.back()->seal();
+    }
+
+    std::unique_ptr<TagJournalSegment> segment(new TagJournalSegment);
+    segment->sequence = _segments.empty() ? 1 : _segments.back()->sequence + 1;
+    segment->file.setFileName(QDir(_directory).filePath(QString("%1.edhj").arg(segment->sequence, 12, 10, QChar('0'))));
+    if (! segment->open(_segmentSize)) {
+        return false;
+    }
+
+    _segments.push_back(std::move(segment));
+    _ids.clear();
+    return true;
+}
+
+bool TagJournal::write(TagJournalSegment *segment, quint16 kind, quint16 type, quint32 tagId, qint64 timestamp, qint32 quality, const char *payload, quint32 size) {
+    qint64 span = recordSpan(size);
+    if (segment->end + span > segment->size) {
+        return false;
+    }
+
+    JournalRecordHeader header;
+    header.checksum = 0;
+    header.kind = kind;
+    header.type = type;
+    header.tagId = tagId;
+    header.size = size;
+    header.timestamp = timestamp;
+    header.quality = quality;
+    header.reserved = 0;
+
+    uchar* record = segment->map + segment->end;
+    std::memcpy(record, &header, sizeof(header));
+    if (size > 0) {
+        std::memcpy(record + sizeof(header), payload, size);
+    }
+    header.checksum = checksum(record + 4, qint64(sizeof(header)) - 4 + size);
+    std::memcpy(record, &header.checksum, sizeof(header.checksum));
+
+    segment->end += span;
+    return true;
+}
+
+quint32 TagJournal::tagId(const QString &tag) {
+    auto it = _ids.find(tag);
+    if (it != _ids.end()) {
+        return it.value();
+    }
+
+    TagJournalSegment* segment = _segments.back().get();
+    quint32 id = quint32(_ids.size() + 1);
+    QByteArray name = tag.toUtf8();
+    if (! write(segment, JournalTagName, 0, id, 0, 0, name.constData(), quint32(name.size()))) {
+        return 0;
+    }
+    segment->names.insert(id, tag);
+    segment->tags[tag].id = id;
+    _ids.insert(tag, id);
+
+    // every segment can be read on its own, so it restates the unit in effect
+    QString current = _units.value(tag);
+    if (! current.isEmpty()) {
+        QByteArray unit = current.toUtf8();
+        qint64 offset = segment->end;
+        if (! write(segment, JournalUnit, 0, id, 0, 0, unit.constData(), quint32(unit.size()))) {
+            _ids.remove(tag);
+            return 0;
+        }
+        segment->tags[tag].units.append(qMakePair(offset, current));
+    }
+    return id;
+}
+
+bool TagJournal::append(const QString &tag, const Tag::Value &value) {
+    if (! _open) {
+        return false;
+    }
+
+    quint16 kind = JournalScalar;
+    quint16 type = quint16(value.value().userType());
+    char scalar[8];
+    QByteArray text;
+
+    switch (value.value().userType()) {
+    case QMetaType::Double: {
+        double d = value.value().toDouble();
+        std::memcpy(scalar, &d, sizeof(d));
+    }
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Bool: {
+        qint64 v = value.value().toLongLong();
+        std::memcpy(scalar, &v, sizeof(v));
+    }
+        break;
+    case QMetaType::QDateTime: {
+        qint64 v = value.value().toDateTime().toMSecsSinceEpoch();
+        std::memcpy(scalar, &v, sizeof(v));
+    }
+        break;
+    default: {
+        QString serialized;
+        QMetaType::Type metaType;
+        std::tie(serialized, metaType) = Serialization::serialize(value.value());
+        if (metaType == QMetaType::UnknownType) {
+            return false;
+        }
+        kind = JournalText;
+        type = quint16(metaType);
+        text = serialized.toUtf8();
+    }
+        break;
+    }
+
+    const char* payload = kind == JournalScalar ? scalar : text.constData();
+    quint32 size = kind == JournalScalar ? quint32(sizeof(scalar)) : quint32(text.size());
+    QByteArray name = tag.toUtf8();
+    QByteArray unit = value.unit().toUtf8();
+
+    // the tag name, unit and sample must land in the same segment, a fresh segment restates both
+    auto needed = [&] {
+        qint64 n = recordSpan(size);
+        if (! _ids.contains(tag)) {
+            n += recordSpan(quint32(name.size())) + recordSpan(quint32(_units.value(tag).toUtf8().size()));
+        }
+        return n + recordSpan(quint32(unit.size()));
+    };
+
+    TagJournalSegment* segment = _segments.back().get();
+    if (segment->end + needed() > segment->size) {
+        if (! roll()) {
+            return false;
+        }
+        segment = _segments.back().get();
+        if (segment->end + needed() > segment->size) {
+            qWarning() << "TagJournal: sample of" << tag << "does not fit a segment";
+            return false;
+        }
+    }
+
+    quint32 id = tagId(tag);
+    if (id == 0) {
+        qWarning() << "TagJournal: unable to record the name of" << tag;
+        return false;
+    }
+
+    bool unitChanged = _units.value(tag) != value.unit();
+    qint64 unitOffset = segment->end;
+    if (unitChanged && ! write(segment, JournalUnit, 0, id, 0, 0, unit.constData(), quint32(unit.size()))) {
+        return false;
+    }
+
+    qint64 offset = segment->end;
+    if (! write(segment, kind, type, id, value.timestamp(), static_cast<qint32>(value.quality()), payload, size)) {
+        // take the unit record back, recovery must not find it past the end
+        std::memset(segment->map + unitOffset, 0, size_t(offset - unitOffset));
+        segment->end = unitOffset;
+        return false;
+    }
+
+    TagJournalSegment::TagIndex& idx = segment->tags[tag];
+    if (unitChanged) {
+        idx.units.append(qMakePair(unitOffset, value.unit()));
+        _units.insert(tag, value.unit());
+    }
+    idx.add(value.timestamp(), offset);
+    segment->last = std::max(segment->last, value.timestamp());
+    return true;
+}
+
+void TagJournal::attach(Client *client) {
+    // the client reports unit and quality ahead of the value they belong to
+    connect(client, &Client::tagUnitUpdated, this, [this](const QString& tag, const QString& unit) {
+        _clientUnits.insert(tag, unit);
+    });
+    connect(client, &Client::tagQualityUpdated, this, [this](const QString& tag, Tag::Quality::Value quality) {
+        _clientQualities.insert(tag, quality);
+    });
+    connect(client, &Client::tagValueUpdated, this, [this](const QString& tag, const QDateTime& timestamp, QMetaType::Type, const QVariant& value) {
+        Tag::Value v;
+        v.timestamp(timestamp.toMSecsSinceEpoch());
+        v.value(value);
+        // a tag the client has not reported a unit for keeps the one journaled last
+        auto unit = _clientUnits.constFind(tag);
+        v.unit(unit != _clientUnits.constEnd() ? unit.value() : _units.value(tag));
+        auto quality = _clientQualities.constFind(tag);
+        if (quality != _clientQualities.constEnd()) {
+            v.quality(quality.value());
+        }
+        append(tag, v);
+    });
+}
+
+QVector<Tag::Value> TagJournal::read(const QString &tag, qint64 from, qint64 to) const {
+    QVector<Tag::Value> result;
+    for (const auto& segment : _segments) {
+        auto idx = segment->tags.constFind(tag);
+        if (idx == segment->tags.constEnd() || idx->count == 0 || idx->last < from || idx->first > to) {
+            continue;
+        }
+        readSegment(segment.get(), idx.value(), from, to, result);
+    }
+
+    // samples out of order within or across segments
+    auto earlier = [](const Tag::Value& a, const Tag::Value& b) {
+        return a.timestamp() < b.timestamp();
+    };
+    if (! std::is_sorted(result.begin(), result.end(), earlier)) {
+        std::stable_sort(result.begin(), result.end(), earlier);
+    }
+    return result;
+}
+
+QStringList TagJournal::tags() const {
+    QSet<QString> tags;
+    for (const auto& segment : _segments) {
+        for (auto it = segment->tags.cbegin(); it != segment->tags.cend(); ++it) {
+            tags.insert(it.key());
+        }
+    }
+    return tags.toList();
+}
+
+qint64 TagJournal::count(const QString &tag) const {
+    qint64 n = 0;
+    for (const auto& segment : _segments) {
+        n += segment->tags.value(tag).count;
+    }
+    return n;
+}
+
+void TagJournal::sync() {
+#ifdef Q_OS_UNIX
+    if (! _segments.empty()) {
+        TagJournalSegment* segment = _segments.back().get();
+        if (segment->map && msync(segment->map, size_t(segment->end), MS_SYNC) != 0) {
+            qWarning() << "TagJournal: msync failed for" << segment->file.fileName();
+        }
+    }
+#endif
+}
+
+void TagJournal::dropBefore(qint64 timestamp) {
+    // the segment being appended to is never dropped
+    while (_segments.size() > 1 && _segments.front()->last < timestamp) {
+        QString path = _segments.front()->file.fileName();
+        QString index = _segments.front()->indexPath();
+        _segments.erase(_segments.begin());
+        QFile::remove(path);
+        QFile::remove(index);
+    }
+}
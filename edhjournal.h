@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+#include "edhtypes.h"
+#include "tagvalue.h"
+
+namespace eDrillingHub {
+    class Client;
+    struct TagJournalSegment;
+
+    /**
+     * @brief TagJournal - append-only, memory-mapped log of tag samples
+     *
+     * Samples of all tags are appended to one sequence of segment files in the journal
+     * directory. Scalar values (double, int, qint64, bool, QDateTime) are stored as fixed-width
+     * records, other values in their protocol text form. Every record carries a checksum;
+     * open() scans the segments, stops at the first torn or unwritten record and continues
+     * appending there, so a crash loses at most the records that were being written.
+     *
+     * Each segment keeps a sparse index per tag: the time bounds, every 128th sample and the
+     * unit changes. read() skips segments outside the range, binary searches the sparse
+     * entries and walks the records from there. A segment's index is written next to it when
+     * the segment is sealed, so open() only scans the segment that was being appended to.
+     * Samples of a tag are expected in roughly increasing time order, a segment holding
+     * out-of-order samples of a tag is walked in full for it.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC TagJournal : public QObject {
+        Q_OBJECT
+    public:
+        TagJournal(const QString& directory, QObject* parent = nullptr);
+        virtual ~TagJournal();
+
+        // takes effect for the next segment created
+        void setSegmentSize(qint64 bytes);
+
+        bool open();
+        void close();
+        bool isOpen() const { return _open; }
+
+        bool append(const QString& tag, const Tag::Value& value);
+        // journals every update the client emits, with the unit and quality it reported for the tag
+        void attach(Client* client);
+
+        QVector<Tag::Value> read(const QString& tag, qint64 from, qint64 to) const;
+        QStringList tags() const;
+        qint64 count(const QString& tag) const;
+
+        // forces the mapped segments to disk, appends survive a process crash without it
+        void sync();
+        // removes whole segments whose samples are all older than timestamp
+        void dropBefore(qint64 timestamp);
+
+    private:
+        bool recover(TagJournalSegment* segment);
+        bool roll();
+        bool write(TagJournalSegment* segment, quint16 kind, quint16 type, quint32 tagId, qint64 timestamp, qint32 quality, const char* payload, quint32 size);
+        quint32 tagId(const QString& tag);
+
+        QString _directory;
+        qint64 _segmentSize;
+        bool _open = false;
+
+        std::vector<std::unique_ptr<TagJournalSegment>> _segments;
+        QHash<QString, quint32> _ids;
+        // the unit in effect per tag, restated at the start of every segment
+        QHash<QString, QString> _units;
+        // last unit and quality the attached clients reported per tag
+        QHash<QString, QString> _clientUnits;
+        QHash<QString, Tag::Quality::Value> _clientQualities;
+    };
+}
@@ -0,0 +1,342 @@
+#include "edhkernels.h"
+
+#include <QDebug>
+
+#include <cmath>
+
+#if defined(__SSE2__) && ! defined(EDHCLIENT_NO_SIMD)
+#define EDH_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace eDrillingHub;
+
+// tile edge of the blocked transpose, a 32x32 tile of doubles fits in L1 twice
+static const qint32 TransposeTile = 32;
+
+#ifdef EDH_KERNELS_SSE2
+static double horizontalMin(__m128d v) {
+    return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double horizontalMax(__m128d v) {
+    return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double horizontalSum(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+#endif
+
+static void minMaxSum(const double* values, qint64 count, double& min, double& max, double& sum) {
+    qint64 i = 0;
+    min = max = values[0];
+    sum = 0;
+
+#ifdef EDH_KERNELS_SSE2
+    if (count >= 2) {
+        __m128d vmin = _mm_loadu_pd(values);
+        __m128d vmax = vmin;
+        __m128d vsum = _mm_setzero_pd();
+        for (; i + 2 <= count; i += 2) {
+            __m128d v = _mm_loadu_pd(values + i);
+            vmin = _mm_min_pd(vmin, v);
+            vmax = _mm_max_pd(vmax, v);
+            vsum = _mm_add_pd(vsum, v);
+        }
+        min = horizontalMin(vmin);
+        max = horizontalMax(vmax);
+        sum = horizontalSum(vsum);
+    }
+#endif
+
+    for (; i < count; i++) {
+        double v = values[i];
+        min = std::min(min, v);
+        max = std::max(max, v);
+        sum += v;
+    }
+}
+
+static double sumSquaredDeviations(const double* values, qint64 count, double mean) {
+    qint64 i = 0;
+    double sum = 0;
+
+#ifdef EDH_KERNELS_SSE2
+    __m128d vmean = _mm_set1_pd(mean);
+    __m128d vsum = _mm_setzero_pd();
+    for (; i + 2 <= count; i += 2) {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(values + i), vmean);
+        vsum = _mm_add_pd(vsum, _mm_mul_pd(d, d));
+    }
+    sum = horizontalSum(vsum);
+#endif
+
+    for (; i < count; i++) {
+        double d = values[i] - mean;
+        sum += d * d;
+    }
+    return sum;
+}
+
+// folds one matrix row into the per column accumulators
+static void accumulateRow(const double* row, qint32 columns, double* min, double* max, double* sum) {
+    qint32 j = 0;
+
+#ifdef EDH_KERNELS_SSE2
+    for (; j + 2 <= columns; j += 2) {
+        __m128d v = _mm_loadu_pd(row + j);
+        _mm_store_pd(min + j, _mm_min_pd(_mm_load_pd(min + j), v));
+        _mm_store_pd(max + j, _mm_max_pd(_mm_load_pd(max + j), v));
+        _mm_store_pd(sum + j, _mm_add_pd(_mm_load_pd(sum + j), v));
+    }
+#endif
+
+    for (; j < columns; j++) {
+        min[j] = std::min(min[j], row[j]);
+        max[j] = std::max(max[j], row[j]);
+        sum[j] += row[j];
+    }
+}
+
+static void accumulateRowDeviations(const double* row, qint32 columns, const double* mean, double* squares) {
+    qint32 j = 0;
+
+#ifdef EDH_KERNELS_SSE2
+    for (; j + 2 <= columns; j += 2) {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(row + j), _mm_load_pd(mean + j));
+        _mm_store_pd(squares + j, _mm_add_pd(_mm_load_pd(squares + j), _mm_mul_pd(d, d)));
+    }
+#endif
+
+    for (; j < columns; j++) {
+        double d = row[j] - mean[j];
+        squares[j] += d * d;
+    }
+}
+
+struct AddOp {
+    double operator()(double a, double b) const { return a + b; }
+#ifdef EDH_KERNELS_SSE2
+    __m128d operator()(__m128d a, __m128d b) const { return _mm_add_pd(a, b); }
+#endif
+};
+
+struct SubtractOp {
+    double operator()(double a, double b) const { return a - b; }
+#ifdef EDH_KERNELS_SSE2
+    __m128d operator()(__m128d a, __m128d b) const { return _mm_sub_pd(a, b); }
+#endif
+};
+
+struct MultiplyOp {
+    double operator()(double a, double b) const { return a * b; }
+#ifdef EDH_KERNELS_SSE2
+    __m128d operator()(__m128d a, __m128d b) const { return _mm_mul_pd(a, b); }
+#endif
+};
+
+template <typename Op>
+static void elementWise(const double* a, const double* b, double* out, qint64 count, Op op) {
+    qint64 i = 0;
+
+#ifdef EDH_KERNELS_SSE2
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, op(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = op(a[i], b[i]);
+    }
+}
+
+template <typename Op>
+static Matrix<double> elementWise(const Matrix<double>& a, const Matrix<double>& b, Op op) {
+    if (a.rows() != b.rows() || a.columns() != b.columns()) {
+        qWarning() << "Kernels: matrix dimensions differ" << a.rows() << "x" << a.columns() << "and" << b.rows() << "x" << b.columns();
+        return Matrix<double>();
+    }
+
+    Matrix<double> out;
+    out.size(a.rows(), a.columns());
+    elementWise(a.constData(), b.constData(), out.data(), qint64(a.rows()) * a.columns(), op);
+    return out;
+}
+
+static Kernels::Stats finishStats(qint64 count, double min, double max, double sum, double squares) {
+    Kernels::Stats s;
+    s.count = count;
+    s.min = min;
+    s.max = max;
+    s.sum = sum;
+    s.mean = sum / count;
+    s.stddev = std::sqrt(squares / count);
+    return s;
+}
+
+bool Kernels::simd() {
+#ifdef EDH_KERNELS_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+Kernels::Stats Kernels::stats(const double *values, qint64 count) {
+    if (count <= 0) {
+        return Stats();
+    }
+
+    double min, max, sum;
+    minMaxSum(values, count, min, max, sum);
+    double squares = sumSquaredDeviations(values, count, sum / count);
+
+    return finishStats(count, min, max, sum, squares);
+}
+
+Kernels::Stats Kernels::stats(const QVector<double> &values) {
+    return stats(values.constData(), values.size());
+}
+
+QVector<Kernels::Stats> Kernels::columnStats(const Matrix<double> &matrix) {
+    qint32 rows = matrix.rows();
+    qint32 columns = matrix.columns();
+    QVector<Stats> result(columns);
+    if (rows == 0 || columns == 0) {
+        return result;
+    }
+
+    // walk the rows so every pass reads contiguous memory, the lanes run over the columns
+    const double* data = matrix.constData();
+    AlignedBuffer<double> min(columns), max(columns), sum(columns), mean(columns), squares(columns);
+    std::copy(data, data + columns, min.data());
+    std::copy(data, data + columns, max.data());
+    std::fill(sum.data(), sum.data() + columns, 0.0);
+    std::fill(squares.data(), squares.data() + columns, 0.0);
+
+    for (qint32 r = 0; r < rows; r++) {
+        accumulateRow(data + qint64(r) * columns, columns, min.data(), max.data(), sum.data());
+    }
+    for (qint32 j = 0; j < columns; j++) {
+        mean[j] = sum[j] / rows;
+    }
+    for (qint32 r = 0; r < rows; r++) {
+        accumulateRowDeviations(data + qint64(r) * columns, columns, mean.data(), squares.data());
+    }
+
+    for (qint32 j = 0; j < columns; j++) {
+        result[j] = finishStats(rows, min[j], max[j], sum[j], squares[j]);
+    }
+    return result;
+}
+
+QVector<Kernels::Stats> Kernels::rowStats(const Matrix<double> &matrix) {
+    QVector<Stats> result(matrix.rows());
+    for (qint32 r = 0; r < matrix.rows(); r++) {
+        result[r] = stats(matrix.constData() + qint64(r) * matrix.columns(), matrix.columns());
+    }
+    return result;
+}
+
+void Kernels::transpose(const double *in, qint32 rows, qint32 columns, double *out) {
+    for (qint32 r0 = 0; r0 < rows; r0 += TransposeTile) {
+        qint32 r1 = std::min(r0 + TransposeTile, rows);
+        for (qint32 c0 = 0; c0 < columns; c0 += TransposeTile) {
+            qint32 c1 = std::min(c0 + TransposeTile, columns);
+
+            qint32 r = r0;
+#ifdef EDH_KERNELS_SSE2
+            // 2x2 blocks: two rows in, two rows out
+            for (; r + 2 <= r1; r += 2) {
+                const double* a = in + qint64(r) * columns;
+                const double* b = a + columns;
+                qint32 c = c0;
+                for (; c + 2 <= c1; c += 2) {
+                    __m128d x = _mm_loadu_pd(a + c);
+                    __m128d y = _mm_loadu_pd(b + c);
+                    _mm_storeu_pd(out + qint64(c) * rows + r, _mm_unpacklo_pd(x, y));
+                    _mm_storeu_pd(out + qint64(c + 1) * rows + r, _mm_unpackhi_pd(x, y));
+                }
+                for (; c < c1; c++) {
+                    out[qint64(c) * rows + r] = a[c];
+                    out[qint64(c) * rows + r + 1] = b[c];
+                }
+            }
+#endif
+            for (; r < r1; r++) {
+                const double* a = in + qint64(r) * columns;
+                for (qint32 c = c0; c < c1; c++) {
+                    out[qint64(c) * rows + r] = a[c];
+                }
+            }
+        }
+    }
+}
+
+Matrix<double> Kernels::transpose(const Matrix<double> &matrix) {
+    Matrix<double> out;
+    out.size(matrix.columns(), matrix.rows());
+    transpose(matrix.constData(), matrix.rows(), matrix.columns(), out.data());
+    return out;
+}
+
+AlignedBuffer<double> Kernels::toColumnMajor(const Matrix<double> &matrix) {
+    AlignedBuffer<double> out(qint64(matrix.rows()) * matrix.columns());
+    transpose(matrix.constData(), matrix.rows(), matrix.columns(), out.data());
+    return out;
+}
+
+Matrix<double> Kernels::fromColumnMajor(const double *values, qint32 rows, qint32 columns) {
+    Matrix<double> out;
+    out.size(rows, columns);
+    transpose(values, columns, rows, out.data());
+    return out;
+}
+
+void Kernels::add(const double *a, const double *b, double *out, qint64 count) {
+    elementWise(a, b, out, count, AddOp());
+}
+
+void Kernels::subtract(const double *a, const double *b, double *out, qint64 count) {
+    elementWise(a, b, out, count, SubtractOp());
+}
+
+void Kernels::multiply(const double *a, const double *b, double *out, qint64 count) {
+    elementWise(a, b, out, count, MultiplyOp());
+}
+
+void Kernels::scale(const double *a, double factor, double offset, double *out, qint64 count) {
+    qint64 i = 0;
+
+#ifdef EDH_KERNELS_SSE2
+    __m128d vfactor = _mm_set1_pd(factor);
+    __m128d voffset = _mm_set1_pd(offset);
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a + i), vfactor), voffset));
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = a[i] * factor + offset;
+    }
+}
+
+Matrix<double> Kernels::add(const Matrix<double> &a, const Matrix<double> &b) {
+    return elementWise(a, b, AddOp());
+}
+
+Matrix<double> Kernels::subtract(const Matrix<double> &a, const Matrix<double> &b) {
+    return elementWise(a, b, SubtractOp());
+}
+
+Matrix<double> Kernels::multiply(const Matrix<double> &a, const Matrix<double> &b) {
+    return elementWise(a, b, MultiplyOp());
+}
+
+Matrix<double> Kernels::scale(const Matrix<double> &a, double factor, double offset) {
+    Matrix<double> out;
+    out.size(a.rows(), a.columns());
+    scale(a.constData(), factor, offset, out.data(), qint64(a.rows()) * a.columns());
+    return out;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QVector>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "edhtypes.h"
+#include "edhmatrix.h"
+
+namespace eDrillingHub {
+    /**
+     * @brief AlignedBuffer - fixed size, SIMD aligned storage for trivially copyable values
+     */
+    template <typename T>
+    class AlignedBuffer {
+        static_assert(std::is_trivially_copyable<T>::value, "AlignedBuffer holds trivially copyable types only");
+    public:
+        static const size_t Alignment = 64;
+
+        AlignedBuffer() {}
+        explicit AlignedBuffer(qint64 size);
+        AlignedBuffer(const AlignedBuffer& other);
+        AlignedBuffer(AlignedBuffer&& other);
+        ~AlignedBuffer();
+
+        AlignedBuffer& operator=(AlignedBuffer other);
+
+        T* data() { return _data; }
+        const T* data() const { return _data; }
+        qint64 size() const { return _size; }
+
+        T& operator[](qint64 i) { return _data[i]; }
+        const T& operator[](qint64 i) const { return _data[i]; }
+
+    private:
+        T* _data = nullptr;
+        qint64 _size = 0;
+    };
+
+    /**
+     * @brief Kernels - statistics, transposes and element-wise arithmetic on double matrices and vectors
+     *
+     * The kernels use SSE2 where the compiler targets it and a scalar loop otherwise, both give
+     * the same results for finite input up to the rounding of sums. Column major data is a plain
+     * array with one column after the other, the layout used by the QDataStream operators of Matrix.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC Kernels {
+    public:
+        struct Stats {
+            qint64 count = 0;
+            double min = 0;
+            double max = 0;
+            double sum = 0;
+            double mean = 0;
+            // population standard deviation
+            double stddev = 0;
+        };
+
+        static bool simd();
+
+        static Stats stats(const double* values, qint64 count);
+        static Stats stats(const QVector<double>& values);
+        static QVector<Stats> columnStats(const Matrix<double>& matrix);
+        static QVector<Stats> rowStats(const Matrix<double>& matrix);
+
+        static Matrix<double> transpose(const Matrix<double>& matrix);
+        static void transpose(const double* in, qint32 rows, qint32 columns, double* out);
+
+        static AlignedBuffer<double> toColumnMajor(const Matrix<double>& matrix);
+        static Matrix<double> fromColumnMajor(const double* values, qint32 rows, qint32 columns);
+
+        static void add(const double* a, const double* b, double* out, qint64 count);
+        static void subtract(const double* a, const double* b, double* out, qint64 count);
+        static void multiply(const double* a, const double* b, double* out, qint64 count);
+        static void scale(const double* a, double factor, double offset, double* out, qint64 count);
+
+        // element-wise, the matrices must have the same dimensions
+        static Matrix<double> add(const Matrix<double>& a, const Matrix<double>& b);
+        static Matrix<double> subtract(const Matrix<double>& a, const Matrix<double>& b);
+        static Matrix<double> multiply(const Matrix<double>& a, const Matrix<double>& b);
+        static Matrix<double> scale(const Matrix<double>& a, double factor, double offset = 0);
+    };
+
+    template <typename T>
+    AlignedBuffer<T>::AlignedBuffer(qint64 size) :
+        _size(size)
+    {
+        if (_size > 0) {
+            _data = static_cast<T*>(qMallocAligned(size_t(_size) * sizeof(T), Alignment));
+            Q_CHECK_PTR(_data);
+        }
+    }
+
+    template <typename T>
+    AlignedBuffer<T>::AlignedBuffer(const AlignedBuffer &other) :
+        AlignedBuffer(other._size)
+    {
+        std::copy(other._data, other._data + other._size, _data);
+    }
+
+    template <typename T>
+    AlignedBuffer<T>::AlignedBuffer(AlignedBuffer &&other) :
+        _data(other._data),
+        _size(other._size)
+    {
+        other._data = nullptr;
+        other._size = 0;
+    }
+
+    template <typename T>
+    AlignedBuffer<T>::~AlignedBuffer() {
+        qFreeAligned(_data);
+    }
+
+    template <typename T>
+    AlignedBuffer<T>& AlignedBuffer<T>::operator=(AlignedBuffer other) {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        return *this;
+    }
+}
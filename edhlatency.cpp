@@ -0,0 +1,122 @@
+#include "edhlatency.h"
+
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+int LatencyHistogram::index(qint64 micros) {
+    if (micros < SubBuckets) {
+        return static_cast<int>(std::max<qint64>(micros, 0));
+    }
+
+    int msb = 63 - qCountLeadingZeroBits(static_cast<quint64>(micros));
+    int sub = static_cast<int>((micros >> (msb - 4)) & (SubBuckets - 1));
+    return std::min((msb - 3) * SubBuckets + sub, Buckets - 1);
+}
+
+qint64 LatencyHistogram::value(int index) {
+    if (index < SubBuckets) {
+        return index;
+    }
+
+    int msb = index / SubBuckets + 3;
+    int sub = index % SubBuckets;
+    return (qint64(SubBuckets + sub)) << (msb - 4);
+}
+
+void LatencyHistogram::record(qint64 micros) {
+    micros = std::max<qint64>(micros, 0);
+    _buckets[index(micros)]++;
+    _count++;
+    _max = std::max(_max, micros);
+}
+
+void LatencyHistogram::reset() {
+    _buckets.fill(0);
+    _count = 0;
+    _max = 0;
+}
+
+qint64 LatencyHistogram::percentile(double p) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    quint64 rank = static_cast<quint64>(p / 100.0 * _count);
+    rank = std::min(std::max<quint64>(rank, 1), _count);
+
+    quint64 seen = 0;
+    for (int i = 0; i < Buckets; i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            return std::min(value(i), _max);
+        }
+    }
+    return _max;
+}
+
+LatencyStats LatencyHistogram::stats() const {
+    LatencyStats s;
+    s.count = _count;
+    s.p50 = percentile(50);
+    s.p99 = percentile(99);
+    s.max = _max;
+    return s;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (int i = 0; i < Buckets; i++) {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+    _max = std::max(_max, other._max);
+}
+
+void LatencyTracker::setClassifier(Classifier classifier) {
+    _classifier = classifier;
+    _tagClasses.clear();
+}
+
+const QString& LatencyTracker::tagClass(const QString &tag, QMetaType::Type type) {
+    auto it = _tagClasses.find(tag);
+    if (it == _tagClasses.end()) {
+        QString name = _classifier ? _classifier(tag, type) : QString(QMetaType::typeName(type));
+        it = _tagClasses.insert(tag, name);
+    }
+    return it.value();
+}
+
+void LatencyTracker::recordServerTime(qint64 serverTime, qint64 localTime) {
+    _offsets[_offsetSamples % int(_offsets.size())] = serverTime - localTime;
+    _offsetSamples++;
+
+    int n = std::min(_offsetSamples, int(_offsets.size()));
+    _offset = *std::max_element(_offsets.begin(), _offsets.begin() + n);
+}
+
+void LatencyTracker::record(const QString &tag, QMetaType::Type type, qint64 sampleToReceipt, qint64 receiptToEmit, qint64 queueWait) {
+    Histograms& h = _histograms[tagClass(tag, type)];
+    h[int(Stage::SampleToReceipt)].record(sampleToReceipt);
+    h[int(Stage::ReceiptToEmit)].record(receiptToEmit);
+    h[int(Stage::QueueWait)].record(queueWait);
+}
+
+LatencyStats LatencyTracker::stats(Stage stage) const {
+    LatencyHistogram all;
+    for (const auto& h : _histograms) {
+        all.merge(h[int(stage)]);
+    }
+    return all.stats();
+}
+
+LatencyStats LatencyTracker::stats(Stage stage, const QString &tagClass) const {
+    auto it = _histograms.find(tagClass);
+    if (it == _histograms.end()) {
+        return LatencyStats();
+    }
+    return it.value()[int(stage)].stats();
+}
+
+void LatencyTracker::reset() {
+    _histograms.clear();
+}
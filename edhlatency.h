@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QMetaType>
+#include <QtAlgorithms>
+
+#include <array>
+#include <functional>
+
+#include "edhtypes.h"
+
+namespace eDrillingHub {
+    struct LatencyStats {
+        quint64 count = 0;
+        qint64 p50 = 0;
+        qint64 p99 = 0;
+        qint64 max = 0;
+    };
+
+    /**
+     * @brief LatencyHistogram - log-linear histogram of microsecond latencies
+     *
+     * Every power of two is split into 16 linear sub-buckets, so recorded values
+     * are reported with at most 1/16 relative error.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC LatencyHistogram {
+    public:
+        void record(qint64 micros);
+        void reset();
+
+        quint64 count() const { return _count; }
+        qint64 max() const { return _max; }
+        qint64 percentile(double p) const;
+        LatencyStats stats() const;
+
+        void merge(const LatencyHistogram& other);
+    private:
+        static const int SubBuckets = 16;
+        static const int Buckets = (64 - 3) * SubBuckets;
+
+        static int index(qint64 micros);
+        static qint64 value(int index);
+
+        std::array<quint64, Buckets> _buckets{};
+        quint64 _count = 0;
+        qint64 _max = 0;
+    };
+
+    /**
+     * @brief LatencyTracker - end-to-end latency of delivered tag updates
+     *
+     * The server clock offset is estimated from "servertime" messages: each message
+     * bounds the offset from below by its transit delay, so the largest of the recent
+     * estimates is kept. Latencies are grouped per tag class, by default the name of
+     * the value type.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC LatencyTracker {
+    public:
+        enum class Stage {
+            SampleToReceipt,
+            ReceiptToEmit,
+            QueueWait
+        };
+
+        using Classifier = std::function<QString(const QString& tag, QMetaType::Type type)>;
+
+        void setClassifier(Classifier classifier);
+
+        // server time minus local time, in milliseconds
+        qint64 clockOffset() const { return _offset; }
+        bool hasClockOffset() const { return _offsetSamples > 0; }
+
+        LatencyStats stats(Stage stage) const;
+        LatencyStats stats(Stage stage, const QString& tagClass) const;
+        QStringList classes() const { return _histograms.keys(); }
+        void reset();
+
+        void recordServerTime(qint64 serverTime, qint64 localTime);
+        void record(const QString& tag, QMetaType::Type type, qint64 sampleToReceipt, qint64 receiptToEmit, qint64 queueWait);
+    private:
+        using Histograms = std::array<LatencyHistogram, 3>;
+
+        const QString& tagClass(const QString& tag, QMetaType::Type type);
+
+        Classifier _classifier;
+        QHash<QString, QString> _tagClasses;
+        QHash<QString, Histograms> _histograms;
+
+        std::array<qint64, 16> _offsets{};
+        int _offsetSamples = 0;
+        qint64 _offset = 0;
+    };
+}
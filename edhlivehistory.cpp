@@ -0,0 +1,170 @@
+#include "edhlivehistory.h"
+
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+int LiveHistory::Snapshot::lowerBound(qint64 timestamp) const {
+    int low = 0, high = _size;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (this->timestamp(middle) < timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+LiveHistory::Segment LiveHistory::Snapshot::older() const {
+    Segment segment;
+    if (_size == 0) {
+        return segment;
+    }
+    segment.timestamps = _timestamps.constData() + _first;
+    segment.values = _values.constData() + _first;
+    segment.size = std::min(_size, _timestamps.size() - _first);
+    return segment;
+}
+
+LiveHistory::Segment LiveHistory::Snapshot::newer() const {
+    Segment segment;
+    int wrapped = _size - (_timestamps.size() - _first);
+    if (_size == 0 || wrapped <= 0) {
+        return segment;
+    }
+    segment.timestamps = _timestamps.constData();
+    segment.values = _values.constData();
+    segment.size = wrapped;
+    return segment;
+}
+
+void LiveHistory::setCapacity(int samples) {
+    _capacity = std::max(samples, 1);
+}
+
+void LiveHistory::setMaxAge(qint64 msecs) {
+    _maxAge = std::max<qint64>(msecs, 0);
+}
+
+void LiveHistory::setTrackAll(bool enable) {
+    _trackAll = enable;
+    _untracked.clear();
+}
+
+void LiveHistory::track(const QString &tag, int capacity, qint64 maxAge) {
+    _untracked.remove(tag);
+    capacity = capacity > 0 ? capacity : _capacity;
+    maxAge = maxAge > 0 ? maxAge : _maxAge;
+
+    auto it = _rings.find(tag);
+    if (it == _rings.end()) {
+        _rings.insert(tag, makeRing(capacity, maxAge));
+        return;
+    }
+
+    // the ring is shared, so it is widened to cover every consumer and keeps its samples
+    Ring& ring = it.value();
+    ring.maxAge = ring.maxAge == 0 || maxAge == 0 ? 0 : std::max(ring.maxAge, maxAge);
+    int current = ring.timestamps.size();
+    if (capacity <= current) {
+        return;
+    }
+
+    Ring wider = makeRing(capacity, ring.maxAge);
+    int first = (ring.head + current - ring.size) % current;
+    for (int i = 0; i < ring.size; i++) {
+        wider.timestamps[i] = ring.timestamps.at((first + i) % current);
+        wider.values[i] = ring.values.at((first + i) % current);
+    }
+    wider.size = ring.size;
+    wider.head = ring.size % capacity;
+    ring = wider;
+}
+
+void LiveHistory::untrack(const QString &tag) {
+    _rings.remove(tag);
+    if (_trackAll) {
+        _untracked.insert(tag);
+    }
+}
+
+bool LiveHistory::isTracked(const QString &tag) const {
+    return _rings.contains(tag) || (_trackAll && ! _untracked.contains(tag));
+}
+
+LiveHistory::Ring LiveHistory::makeRing(int capacity, qint64 maxAge) const {
+    Ring ring;
+    ring.timestamps.resize(capacity);
+    ring.values.resize(capacity);
+    ring.maxAge = maxAge;
+    return ring;
+}
+
+void LiveHistory::append(const QString &tag, qint64 timestamp, QMetaType::Type type, const QVariant &value) {
+    switch (type) {
+    case QMetaType::Double:
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Bool:
+        break;
+    default:
+        return;
+    }
+
+    auto it = _rings.find(tag);
+    if (it == _rings.end()) {
+        if (! _trackAll || _untracked.contains(tag)) {
+            return;
+        }
+        it = _rings.insert(tag, makeRing(_capacity, _maxAge));
+    }
+
+    Ring& ring = it.value();
+    int capacity = ring.timestamps.size();
+    if (ring.size > 0 && timestamp < ring.timestamps.at((ring.head + capacity - 1) % capacity)) {
+        return;
+    }
+
+    // detaches from live snapshots, at most once per snapshot
+    qint64* timestamps = ring.timestamps.data();
+    double* values = ring.values.data();
+
+    timestamps[ring.head] = timestamp;
+    values[ring.head] = value.toDouble();
+    ring.head = (ring.head + 1) % capacity;
+    if (ring.size < capacity) {
+        ring.size++;
+    }
+
+    if (ring.maxAge > 0) {
+        qint64 oldest = timestamp - ring.maxAge;
+        while (ring.size > 1 && timestamps[(ring.head + capacity - ring.size) % capacity] < oldest) {
+            ring.size--;
+        }
+    }
+}
+
+LiveHistory::Snapshot LiveHistory::snapshot(const QString &tag) const {
+    Snapshot snapshot;
+    auto it = _rings.constFind(tag);
+    if (it == _rings.constEnd() || it.value().size == 0) {
+        return snapshot;
+    }
+
+    const Ring& ring = it.value();
+    int capacity = ring.timestamps.size();
+    snapshot._timestamps = ring.timestamps;
+    snapshot._values = ring.values;
+    snapshot._first = (ring.head + capacity - ring.size) % capacity;
+    snapshot._size = ring.size;
+    return snapshot;
+}
+
+void LiveHistory::clear() {
+    for (auto& ring : _rings) {
+        ring.head = 0;
+        ring.size = 0;
+    }
+}
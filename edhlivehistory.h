@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QVariant>
+#include <QStringList>
+
+#include "edhtypes.h"
+
+namespace eDrillingHub {
+    /**
+     * @brief LiveHistory - one ring buffer of recent live samples per tag, shared by all consumers
+     *
+     * Numeric scalar updates (double, int, qint64, bool) of tracked tags are appended to a
+     * fixed-capacity ring of timestamps and values kept as two contiguous arrays, optionally
+     * bounded by age as well. Samples older than the newest one of the tag are dropped, so a
+     * ring is always sorted by time.
+     *
+     * snapshot() shares the arrays instead of copying them; the ring only copies them when it
+     * is written while a snapshot is alive. Take snapshots on the client's thread, the
+     * snapshots themselves may be handed to other threads.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC LiveHistory {
+    public:
+        struct Segment {
+            const qint64* timestamps = nullptr;
+            const double* values = nullptr;
+            int size = 0;
+        };
+
+        class EXPORT_LIBEDRILLINGHUB_SPEC Snapshot {
+        public:
+            int size() const { return _size; }
+            bool isEmpty() const { return _size == 0; }
+
+            // oldest first
+            qint64 timestamp(int i) const { return _timestamps[index(i)]; }
+            double value(int i) const { return _values[index(i)]; }
+            // first i with timestamp(i) >= timestamp
+            int lowerBound(qint64 timestamp) const;
+
+            // the samples as up to two contiguous runs, older() holds the oldest ones
+            Segment older() const;
+            Segment newer() const;
+
+        private:
+            friend class LiveHistory;
+
+            int index(int i) const { return (_first + i) % _timestamps.size(); }
+
+            QVector<qint64> _timestamps;
+            QVector<double> _values;
+            int _first = 0;
+            int _size = 0;
+        };
+
+        // defaults for tags tracked without explicit bounds
+        void setCapacity(int samples);
+        int capacity() const { return _capacity; }
+        void setMaxAge(qint64 msecs);
+        qint64 maxAge() const { return _maxAge; }
+
+        // tracks every numeric tag with the default bounds
+        void setTrackAll(bool enable);
+        // 0 takes the default bound, maxAge is relative to the newest sample of the tag;
+        // tracking a tracked tag again only widens its bounds and keeps its samples
+        void track(const QString& tag, int capacity = 0, qint64 maxAge = 0);
+        void untrack(const QString& tag);
+        bool isTracked(const QString& tag) const;
+
+        void append(const QString& tag, qint64 timestamp, QMetaType::Type type, const QVariant& value);
+
+        Snapshot snapshot(const QString& tag) const;
+        QStringList tags() const { return _rings.keys(); }
+        void clear();
+
+    private:
+        struct Ring {
+            QVector<qint64> timestamps;
+            QVector<double> values;
+            qint64 maxAge = 0;
+            int head = 0;
+            int size = 0;
+        };
+
+        Ring makeRing(int capacity, qint64 maxAge) const;
+
+        QHash<QString, Ring> _rings;
+        QSet<QString> _untracked;
+        bool _trackAll = false;
+        int _capacity = 4096;
+        qint64 _maxAge = 0;
+    };
+}
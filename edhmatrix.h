@@ -6,7 +6,40 @@
 #include <QVariant>
 #include <QDataStream>
 
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
 namespace eDrillingHub {
+template <typename T>
+class Matrix;
+
+/**
+ * @brief MatrixView - non-owning window onto a row, column or block of a Matrix
+ *
+ * Elements are addressed like the matrix itself, stride is the distance between
+ * two rows. A view is invalidated by anything that reallocates or detaches the matrix.
+ */
+template <typename T>
+class MatrixView {
+public:
+    MatrixView(T* data, qint32 rows, qint32 columns, qint32 stride);
+
+    T& operator()(qint32 row, qint32 column) const;
+
+    qint32 rows() const;
+    qint32 columns() const;
+    qint32 stride() const;
+    T* data() const;
+
+    bool isContiguous() const;
+    Matrix<typename std::remove_const<T>::type> toMatrix() const;
+
+private:
+    T* _data;
+    qint32 _rows, _columns, _stride;
+};
+
 template <typename T>
 class Matrix : public QVector<T> {
 public:
@@ -25,6 +58,15 @@ public:
 
     void appendRows(qint32 rows);
     void appendColumns(qint32 columns, T value);
+    // changes the dimensions in place, elements keep their row and column
+    void reshape(qint32 rows, qint32 columns, T value = T());
+
+    MatrixView<T> row(qint32 row);
+    MatrixView<const T> row(qint32 row) const;
+    MatrixView<T> column(qint32 column);
+    MatrixView<const T> column(qint32 column) const;
+    MatrixView<T> block(qint32 row, qint32 column, qint32 rows, qint32 columns);
+    MatrixView<const T> block(qint32 row, qint32 column, qint32 rows, qint32 columns) const;
 
 private:
     qint32 _rows, _columns;
@@ -102,16 +144,81 @@ void Matrix<T>::appendColumns(qint32 columns, T value) {
         return;
     }
 
-    int i;
-    QVector<T>::reserve(columns * _rows);
-    quint32 extraColumns = columns - _columns;
-    for (i = _rows; i > 0; i--) {
-        QVector<T>::insert(i * _columns, extraColumns, value);
+    reshape(_rows, columns, value);
+}
+
+template <typename T>
+void Matrix<T>::reshape(qint32 rows, qint32 columns, T value) {
+    if (rows == _rows && columns == _columns) {
+        return;
+    }
+
+    qint32 keepRows = std::min(rows, _rows);
+    qint32 keepColumns = std::min(columns, _columns);
+    qint32 oldSize = _rows * _columns;
+    qint32 newSize = rows * columns;
+
+    if (columns <= _columns) {
+        // rows move towards the front, so walk them front to back
+        if (columns < _columns) {
+            T* data = QVector<T>::data();
+            for (qint32 r = 1; r < keepRows; r++) {
+                std::move(data + r * _columns, data + r * _columns + keepColumns, data + r * columns);
+            }
+        }
+        QVector<T>::resize(newSize);
+    } else {
+        // rows move towards the back, so walk them back to front
+        QVector<T>::resize(std::max(oldSize, newSize));
+        T* data = QVector<T>::data();
+        for (qint32 r = keepRows - 1; r >= 0; r--) {
+            if (r > 0) {
+                std::move_backward(data + r * _columns, data + r * _columns + keepColumns, data + r * columns + keepColumns);
+            }
+            std::fill(data + r * columns + keepColumns, data + (r + 1) * columns, value);
+        }
+        QVector<T>::resize(newSize);
+    }
+
+    if (rows > keepRows) {
+        T* data = QVector<T>::data();
+        std::fill(data + keepRows * columns, data + newSize, value);
     }
 
+    _rows = rows;
     _columns = columns;
 }
 
+template <typename T>
+MatrixView<T> Matrix<T>::row(qint32 row) {
+    return MatrixView<T>(QVector<T>::data() + row * _columns, 1, _columns, _columns);
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::row(qint32 row) const {
+    return MatrixView<const T>(QVector<T>::constData() + row * _columns, 1, _columns, _columns);
+}
+
+template <typename T>
+MatrixView<T> Matrix<T>::column(qint32 column) {
+    return MatrixView<T>(QVector<T>::data() + column, _rows, 1, _columns);
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::column(qint32 column) const {
+    return MatrixView<const T>(QVector<T>::constData() + column, _rows, 1, _columns);
+}
+
+template <typename T>
+MatrixView<T> Matrix<T>::block(qint32 row, qint32 column, qint32 rows, qint32 columns) {
+    return MatrixView<T>(QVector<T>::data() + row * _columns + column, rows, columns, _columns);
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::block(qint32 row, qint32 column, qint32 rows, qint32 columns) const {
+    return MatrixView<const T>(QVector<T>::constData() + row * _columns + column, rows, columns, _columns);
+}
+
 template <typename T>
 T& Matrix<T>::operator()(qint32 row, qint32 column) {
     return QVector<T>::operator [](row * _columns + column);
@@ -121,6 +228,206 @@ const T& Matrix<T>::operator()(qint32 row, qint32 column) const {
     return QVector<T>::operator [](row * _columns + column);
 }
 
+template <typename T>
+MatrixView<T>::MatrixView(T* data, qint32 rows, qint32 columns, qint32 stride) :
+    _data(data),
+    _rows(rows),
+    _columns(columns),
+    _stride(stride)
+{
+}
+
+template <typename T>
+T& MatrixView<T>::operator()(qint32 row, qint32 column) const {
+    return _data[row * _stride + column];
+}
+
+template <typename T>
+qint32 MatrixView<T>::rows() const {
+    return _rows;
+}
+
+template <typename T>
+qint32 MatrixView<T>::columns() const {
+    return _columns;
+}
+
+template <typename T>
+qint32 MatrixView<T>::stride() const {
+    return _stride;
+}
+
+template <typename T>
+T* MatrixView<T>::data() const {
+    return _data;
+}
+
+template <typename T>
+bool MatrixView<T>::isContiguous() const {
+    return _rows <= 1 || _stride == _columns;
+}
+
+template <typename T>
+Matrix<typename std::remove_const<T>::type> MatrixView<T>::toMatrix() const {
+    Matrix<typename std::remove_const<T>::type> m;
+    m.size(_rows, _columns);
+    for (qint32 r = 0; r < _rows; r++) {
+        std::copy(_data + r * _stride, _data + r * _stride + _columns, m.data() + r * _columns);
+    }
+    return m;
+}
+
+/*
+ * The stream format is column-major with every element written by QDataStream. Arithmetic
+ * types are moved through a column-major scratch buffer with readRawData/writeRawData
+ * instead, swapped to the stream byte order, which produces the same bytes.
+ */
+namespace MatrixStream {
+    // bool is excluded, QDataStream normalises it to 0/1 on read
+    template <typename T>
+    using IsRaw = std::integral_constant<bool, std::is_arithmetic<T>::value && ! std::is_same<T, bool>::value>;
+
+    const qint32 ChunkElements = 8192;
+
+    template <typename T>
+    bool rawCompatible(const QDataStream& s) {
+        if (std::is_same<T, double>::value) {
+            return s.floatingPointPrecision() == QDataStream::DoublePrecision;
+        }
+        if (std::is_same<T, float>::value) {
+            return s.floatingPointPrecision() == QDataStream::SinglePrecision;
+        }
+        return ! std::is_floating_point<T>::value;
+    }
+
+    template <typename T>
+    void swap(T* values, qint32 count) {
+        if (sizeof(T) == 1) {
+            return;
+        }
+        for (qint32 i = 0; i < count; i++) {
+            uchar* bytes = reinterpret_cast<uchar*>(values + i);
+            std::reverse(bytes, bytes + sizeof(T));
+        }
+    }
+
+    inline bool needsSwap(const QDataStream& s) {
+        QDataStream::ByteOrder host = QSysInfo::ByteOrder == QSysInfo::BigEndian ? QDataStream::BigEndian : QDataStream::LittleEndian;
+        return s.byteOrder() != host;
+    }
+
+    template <typename T>
+    void readElements(QDataStream& s, Matrix<T>& v) {
+        for (qint32 column = 0; column < v.columns(); column++) {
+            for (qint32 row = 0; row < v.rows(); row++) {
+                T t;
+                s >> t;
+                v(row, column) = t;
+            }
+        }
+    }
+
+    template <typename T>
+    void writeElements(QDataStream& s, const Matrix<T>& v) {
+        for (qint32 column = 0; column < v.columns(); column++) {
+            for (qint32 row = 0; row < v.rows(); row++) {
+                s << v(row, column);
+            }
+        }
+    }
+
+    template <typename T>
+    void read(QDataStream& s, Matrix<T>& v, std::false_type) {
+        readElements(s, v);
+    }
+
+    template <typename T>
+    void write(QDataStream& s, const Matrix<T>& v, std::false_type) {
+        writeElements(s, v);
+    }
+
+    template <typename T>
+    void read(QDataStream& s, Matrix<T>& v, std::true_type) {
+        if (! rawCompatible<T>(s)) {
+            readElements(s, v);
+            return;
+        }
+
+        qint32 rows = v.rows();
+        qint32 columns = v.columns();
+        if (rows == 0 || columns == 0) {
+            return;
+        }
+
+        bool swapBytes = needsSwap(s);
+        qint32 chunkColumns = std::max<qint32>(1, ChunkElements / rows);
+        QVector<T> buffer(std::min(chunkColumns, columns) * rows);
+        T* data = v.data();
+
+        for (qint32 first = 0; first < columns; first += chunkColumns) {
+            qint32 n = std::min(chunkColumns, columns - first);
+            int bytes = int(n * rows * sizeof(T));
+            if (s.readRawData(reinterpret_cast<char*>(buffer.data()), bytes) != bytes) {
+                s.setStatus(QDataStream::ReadPastEnd);
+                std::fill(v.begin(), v.end(), T());
+                return;
+            }
+            if (swapBytes) {
+                swap(buffer.data(), n * rows);
+            }
+
+            if (columns == 1) {
+                std::memcpy(data, buffer.constData(), size_t(rows) * sizeof(T));
+                continue;
+            }
+            for (qint32 c = 0; c < n; c++) {
+                const T* src = buffer.constData() + c * rows;
+                for (qint32 row = 0; row < rows; row++) {
+                    data[row * columns + first + c] = src[row];
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void write(QDataStream& s, const Matrix<T>& v, std::true_type) {
+        if (! rawCompatible<T>(s)) {
+            writeElements(s, v);
+            return;
+        }
+
+        qint32 rows = v.rows();
+        qint32 columns = v.columns();
+        if (rows == 0 || columns == 0) {
+            return;
+        }
+
+        bool swapBytes = needsSwap(s);
+        qint32 chunkColumns = std::max<qint32>(1, ChunkElements / rows);
+        QVector<T> buffer(std::min(chunkColumns, columns) * rows);
+        const T* data = v.constData();
+
+        for (qint32 first = 0; first < columns; first += chunkColumns) {
+            qint32 n = std::min(chunkColumns, columns - first);
+            for (qint32 c = 0; c < n; c++) {
+                T* dst = buffer.data() + c * rows;
+                for (qint32 row = 0; row < rows; row++) {
+                    dst[row] = data[row * columns + first + c];
+                }
+            }
+            if (swapBytes) {
+                swap(buffer.data(), n * rows);
+            }
+
+            int bytes = int(n * rows * sizeof(T));
+            if (s.writeRawData(reinterpret_cast<const char*>(buffer.constData()), bytes) != bytes) {
+                s.setStatus(QDataStream::WriteFailed);
+                return;
+            }
+        }
+    }
+}
+
 template<typename T>
 QDataStream& operator>>(QDataStream& s, Matrix<T>& v) {
     quint32 columns, rows;
@@ -129,13 +436,7 @@ QDataStream& operator>>(QDataStream& s, Matrix<T>& v) {
     s >> rows;
 
     v.size(rows, columns);
-    for (quint32 column = 0; column < columns; column++) {
-        for (quint32 row = 0; row < rows; row++) {
-            T t;
-            s >> t;
-            v(row, column) = t;
-        }
-    }
+    MatrixStream::read(s, v, MatrixStream::IsRaw<T>());
 
     return s;
 }
@@ -148,11 +449,7 @@ QDataStream& operator<<(QDataStream& s, const Matrix<T>& v) {
     s << quint32(columns);
     s << quint32(rows);
 
-    for (quint32 column = 0; column < columns; column++) {
-        for (quint32 row = 0; row < rows; row++) {
-            s << v(row, column);
-        }
-    }
+    MatrixStream::write(s, v, MatrixStream::IsRaw<T>());
 
     return s;
 }
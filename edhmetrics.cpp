@@ -0,0 +1,172 @@
+#include "edhmetrics.h"
+#include "edhclient.h"
+
+#include <QDebug>
+#include <QSaveFile>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+using namespace eDrillingHub;
+
+static const char* const counter_names[] = {
+    "lines_received",
+    "bytes_received",
+    "binary_bytes_received",
+    "lines_sent",
+    "bytes_sent",
+    "value_updates",
+    "quality_updates",
+    "unit_updates",
+    "range_samples",
+    "malformed_lines",
+    "dropped_updates",
+    "reconnects",
+};
+
+static const char* const gauge_names[] = {
+    "read_buffer_bytes",
+    "reading_tags",
+    "pending_range_requests",
+    "downloads",
+    "uploads",
+    "subscriptions",
+};
+
+static const char* const command_names[] = {
+    "servertime",
+    "browse",
+    "subscription",
+    "read",
+    "readStart",
+    "readEnd",
+    "subscribe",
+    "file",
+    "db",
+    "unknown",
+};
+
+static_assert(sizeof(counter_names) / sizeof(counter_names[0]) == int(Metrics::Counter::Count), "counter names out of sync");
+static_assert(sizeof(gauge_names) / sizeof(gauge_names[0]) == int(Metrics::Gauge::Count), "gauge names out of sync");
+static_assert(sizeof(command_names) / sizeof(command_names[0]) == int(Metrics::Command::Count), "command names out of sync");
+
+const char* Metrics::name(Counter counter) {
+    return counter_names[int(counter)];
+}
+
+const char* Metrics::name(Gauge gauge) {
+    return gauge_names[int(gauge)];
+}
+
+const char* Metrics::name(Command command) {
+    return command_names[int(command)];
+}
+
+void Metrics::time(Command command, quint64 nsecs) {
+    Timing& t = _commands[int(command)];
+    t.count.fetch_add(1, std::memory_order_relaxed);
+    t.totalNs.fetch_add(nsecs, std::memory_order_relaxed);
+
+    quint64 max = t.maxNs.load(std::memory_order_relaxed);
+    while (nsecs > max && ! t.maxNs.compare_exchange_weak(max, nsecs, std::memory_order_relaxed)) {
+    }
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot s;
+
+    for (int i = 0; i < int(Counter::Count); i++) {
+        s.counters.append(qMakePair(QString(counter_names[i]), _counters[i].load(std::memory_order_relaxed)));
+    }
+    for (int i = 0; i < int(Gauge::Count); i++) {
+        s.gauges.append(qMakePair(QString(gauge_names[i]), _gauges[i].load(std::memory_order_relaxed)));
+    }
+    for (int i = 0; i < int(Command::Count); i++) {
+        MetricsSnapshot::Timing t;
+        t.count = _commands[i].count.load(std::memory_order_relaxed);
+        t.totalNs = _commands[i].totalNs.load(std::memory_order_relaxed);
+        t.maxNs = _commands[i].maxNs.load(std::memory_order_relaxed);
+        s.commands.append(qMakePair(QString(command_names[i]), t));
+    }
+
+    return s;
+}
+
+void Metrics::reset() {
+    for (auto& c : _counters) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    for (auto& t : _commands) {
+        t.count.store(0, std::memory_order_relaxed);
+        t.totalNs.store(0, std::memory_order_relaxed);
+        t.maxNs.store(0, std::memory_order_relaxed);
+    }
+}
+
+QString MetricsSnapshot::toText() const {
+    QString text;
+
+    for (const auto& c : counters) {
+        text += QString("edhclient_%1 %2\n").arg(c.first).arg(c.second);
+    }
+    for (const auto& g : gauges) {
+        text += QString("edhclient_%1 %2\n").arg(g.first).arg(g.second);
+    }
+    for (const auto& c : commands) {
+        text += QString("edhclient_command_count{command=\"%1\"} %2\n").arg(c.first).arg(c.second.count);
+        text += QString("edhclient_command_nanoseconds_total{command=\"%1\"} %2\n").arg(c.first).arg(c.second.totalNs);
+        text += QString("edhclient_command_nanoseconds_max{command=\"%1\"} %2\n").arg(c.first).arg(c.second.maxNs);
+    }
+
+    return text;
+}
+
+QByteArray MetricsSnapshot::toJson() const {
+    QJsonObject jsonCounters, jsonGauges, jsonCommands;
+
+    for (const auto& c : counters) {
+        jsonCounters.insert(c.first, double(c.second));
+    }
+    for (const auto& g : gauges) {
+        jsonGauges.insert(g.first, double(g.second));
+    }
+    for (const auto& c : commands) {
+        QJsonObject timing;
+        timing.insert("count", double(c.second.count));
+        timing.insert("total_ns", double(c.second.totalNs));
+        timing.insert("max_ns", double(c.second.maxNs));
+        jsonCommands.insert(c.first, timing);
+    }
+
+    QJsonObject root;
+    root.insert("counters", jsonCounters);
+    root.insert("gauges", jsonGauges);
+    root.insert("commands", jsonCommands);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+MetricsExporter::MetricsExporter(const Client *client, const QString &path, Format format, int interval, QObject *parent) :
+    QObject(parent),
+    _client(client),
+    _path(path),
+    _format(format)
+{
+    connect(&_timer, &QTimer::timeout, this, &MetricsExporter::exportNow);
+    _timer.start(interval);
+}
+
+void MetricsExporter::exportNow() {
+    MetricsSnapshot snapshot = _client->metrics().snapshot();
+
+    QSaveFile file(_path);
+    if (! file.open(QIODevice::WriteOnly)) {
+        qWarning() << "MetricsExporter: unable to write" << _path << file.errorString();
+        return;
+    }
+
+    if (_format == Format::Json) {
+        file.write(snapshot.toJson());
+    } else {
+        file.write(snapshot.toText().toUtf8());
+    }
+    file.commit();
+}
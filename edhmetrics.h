@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QPair>
+
+#include <array>
+#include <atomic>
+
+#include "edhtypes.h"
+
+namespace eDrillingHub {
+    class Client;
+
+    struct EXPORT_LIBEDRILLINGHUB_SPEC MetricsSnapshot {
+        struct Timing {
+            quint64 count = 0;
+            quint64 totalNs = 0;
+            quint64 maxNs = 0;
+        };
+
+        QVector<QPair<QString, quint64>> counters;
+        QVector<QPair<QString, qint64>> gauges;
+        QVector<QPair<QString, Timing>> commands;
+
+        QString toText() const;
+        QByteArray toJson() const;
+    };
+
+    /**
+     * @brief Metrics - always-on counters and gauges of a client
+     *
+     * All updates are relaxed atomics, so the registry is cheap enough for the line
+     * handling path and may be snapshotted from any thread.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC Metrics {
+    public:
+        enum class Counter {
+            LinesReceived,
+            BytesReceived,
+            BinaryBytesReceived,
+            LinesSent,
+            BytesSent,
+            ValueUpdates,
+            QualityUpdates,
+            UnitUpdates,
+            RangeSamples,
+            MalformedLines,
+            DroppedUpdates,
+            Reconnects,
+            Count
+        };
+
+        enum class Gauge {
+            ReadBufferBytes,
+            ReadingTags,
+            PendingRangeRequests,
+            Downloads,
+            Uploads,
+            Subscriptions,
+            Count
+        };
+
+        enum class Command {
+            ServerTime,
+            Browse,
+            Subscription,
+            Read,
+            ReadStart,
+            ReadEnd,
+            Subscribe,
+            File,
+            Db,
+            Unknown,
+            Count
+        };
+
+        void add(Counter counter, quint64 n = 1) {
+            _counters[int(counter)].fetch_add(n, std::memory_order_relaxed);
+        }
+        void set(Gauge gauge, qint64 value) {
+            _gauges[int(gauge)].store(value, std::memory_order_relaxed);
+        }
+        void time(Command command, quint64 nsecs);
+
+        quint64 value(Counter counter) const {
+            return _counters[int(counter)].load(std::memory_order_relaxed);
+        }
+        qint64 value(Gauge gauge) const {
+            return _gauges[int(gauge)].load(std::memory_order_relaxed);
+        }
+
+        MetricsSnapshot snapshot() const;
+        void reset();
+
+        static const char* name(Counter counter);
+        static const char* name(Gauge gauge);
+        static const char* name(Command command);
+    private:
+        struct Timing {
+            std::atomic<quint64> count{0};
+            std::atomic<quint64> totalNs{0};
+            std::atomic<quint64> maxNs{0};
+        };
+
+        std::array<std::atomic<quint64>, int(Counter::Count)> _counters{};
+        std::array<std::atomic<qint64>, int(Gauge::Count)> _gauges{};
+        std::array<Timing, int(Command::Count)> _commands;
+    };
+
+    /**
+     * @brief MetricsExporter - periodically writes a client's metrics snapshot to a file
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC MetricsExporter : public QObject {
+        Q_OBJECT
+    public:
+        enum class Format {
+            Text,
+            Json
+        };
+
+        MetricsExporter(const Client* client, const QString& path, Format format, int interval, QObject* parent = nullptr);
+
+        void exportNow();
+    private:
+        const Client* _client;
+        QString _path;
+        Format _format;
+        QTimer _timer;
+    };
+}
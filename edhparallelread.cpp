@@ -0,0 +1,191 @@
+#include "edhparallelread.h"
+#include "edhasync.h"
+
+#include <QFutureInterface>
+#include <QFutureWatcher>
+
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+struct ParallelRangeReader::Job {
+    QFutureInterface<ReadTagHolder> promise;
+    QString tag;
+    qint64 from, to;
+
+    QFuture<QPair<qint64, qint64>> extent;
+    QVector<QPair<qint64, qint64>> ranges;
+    QVector<QFuture<ReadTagHolder>> reads;
+    int remaining = 0;
+    bool done = false;
+};
+
+ParallelRangeReader::ParallelRangeReader(AsyncClient *connection, QObject *parent) :
+    ParallelRangeReader(QVector<AsyncClient*>{connection}, parent)
+{
+}
+
+ParallelRangeReader::ParallelRangeReader(const QVector<AsyncClient*> &connections, QObject *parent) :
+    QObject(parent),
+    _connections(connections)
+{
+    Q_ASSERT(! _connections.isEmpty());
+}
+
+void ParallelRangeReader::setParts(int parts) {
+    _parts = std::max(parts, 1);
+}
+
+void ParallelRangeReader::setMinimumSpan(qint64 msecs) {
+    _minimumSpan = std::max<qint64>(msecs, 1);
+}
+
+QVector<QPair<qint64, qint64>> ParallelRangeReader::split(qint64 from, qint64 to, int parts, qint64 minimumSpan) {
+    QVector<QPair<qint64, qint64>> ranges;
+    if (to < from) {
+        return ranges;
+    }
+
+    qint64 span = to - from + 1;
+    qint64 count = std::max<qint64>(1, std::min<qint64>(parts, span / std::max<qint64>(minimumSpan, 1)));
+    qint64 step = span / count;
+
+    ranges.reserve(int(count));
+    qint64 start = from;
+    for (qint64 i = 0; i < count; i++) {
+        qint64 end = i + 1 == count ? to : start + step - 1;
+        ranges.append(qMakePair(start, end));
+        start = end + 1;
+    }
+    return ranges;
+}
+
+QFuture<ReadTagHolder> ParallelRangeReader::read(const QString &tag, const QDateTime &from, const QDateTime &to) {
+    auto job = std::make_shared<Job>();
+    job->promise.reportStarted();
+    job->tag = tag;
+    job->from = from.toMSecsSinceEpoch();
+    job->to = to.toMSecsSinceEpoch();
+    QFuture<ReadTagHolder> result = job->promise.future();
+
+    auto watcher = new QFutureWatcher<ReadTagHolder>(this);
+    connect(watcher, &QFutureWatcherBase::canceled, this, [this, job] {
+        cancel(job);
+    });
+    connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(result);
+
+    auto extent = new QFutureWatcher<QPair<qint64, qint64>>(this);
+    connect(extent, &QFutureWatcherBase::finished, this, [this, job, extent] {
+        extent->deleteLater();
+        if (job->done) {
+            return;
+        }
+        if (extent->isCanceled()) {
+            cancel(job);
+            return;
+        }
+
+        QPair<qint64, qint64> stored = extent->result();
+        start(job, std::max(job->from, stored.first), std::min(job->to, stored.second));
+    });
+    job->extent = _connections[_next++ % _connections.size()]->queryTagRange(tag);
+    extent->setFuture(job->extent);
+
+    return result;
+}
+
+void ParallelRangeReader::start(const std::shared_ptr<Job> &job, qint64 first, qint64 last) {
+    // one sub-range per connection, see the class comment
+    job->ranges = split(first, last, std::min(_parts, _connections.size()), _minimumSpan);
+    if (job->ranges.isEmpty()) {
+        finish(job);
+        return;
+    }
+
+    job->remaining = job->ranges.size();
+    job->reads.reserve(job->ranges.size());
+    int offset = _next++;
+    for (int i = 0; i < job->ranges.size(); i++) {
+        const QPair<qint64, qint64>& range = job->ranges[i];
+        AsyncClient* connection = _connections[(offset + i) % _connections.size()];
+        QFuture<ReadTagHolder> part = connection->readTagRange(job->tag,
+                                                               QDateTime::fromMSecsSinceEpoch(range.first, Qt::UTC),
+                                                               QDateTime::fromMSecsSinceEpoch(range.second, Qt::UTC));
+        job->reads.append(part);
+
+        auto watcher = new QFutureWatcher<ReadTagHolder>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, job, watcher] {
+            watcher->deleteLater();
+            if (job->done) {
+                return;
+            }
+            // a part that timed out or lost its connection fails the whole read
+            if (watcher->isCanceled()) {
+                cancel(job);
+                return;
+            }
+            if (--job->remaining == 0) {
+                finish(job);
+            }
+        });
+        watcher->setFuture(part);
+    }
+}
+
+void ParallelRangeReader::finish(const std::shared_ptr<Job> &job) {
+    ReadTagHolder holder;
+    holder.from = QDateTime::fromMSecsSinceEpoch(job->from).toUTC();
+    holder.to = QDateTime::fromMSecsSinceEpoch(job->to).toUTC();
+
+    int total = 0;
+    for (const auto& read : job->reads) {
+        total += read.result().timestamps.size();
+    }
+    holder.timestamps.reserve(total);
+    holder.values.reserve(total);
+
+    for (int i = 0; i < job->reads.size(); i++) {
+        ReadTagHolder part = job->reads[i].result();
+        const QPair<qint64, qint64>& range = job->ranges[i];
+        if (part.timestamps.isEmpty()) {
+            continue;
+        }
+
+        if (part.timestamps.first().toMSecsSinceEpoch() >= range.first && part.timestamps.last().toMSecsSinceEpoch() <= range.second) {
+            holder.timestamps.append(part.timestamps);
+            holder.values.append(part.values);
+            continue;
+        }
+
+        // drop samples a server repeats beyond the edges of the sub-range
+        for (int j = 0; j < part.timestamps.size(); j++) {
+            qint64 ts = part.timestamps[j].toMSecsSinceEpoch();
+            if (ts >= range.first && ts <= range.second) {
+                holder.timestamps.append(part.timestamps[j]);
+                holder.values.append(part.values[j]);
+            }
+        }
+    }
+
+    job->done = true;
+    job->reads.clear();
+    job->promise.reportResult(holder);
+    job->promise.reportFinished();
+}
+
+void ParallelRangeReader::cancel(const std::shared_ptr<Job> &job) {
+    if (job->done) {
+        return;
+    }
+    job->done = true;
+
+    job->extent.cancel();
+    for (auto& read : job->reads) {
+        read.cancel();
+    }
+    job->reads.clear();
+
+    job->promise.reportCanceled();
+    job->promise.reportFinished();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QObject>
+#include <QFuture>
+#include <QVector>
+#include <QPair>
+#include <memory>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+
+namespace eDrillingHub {
+    class AsyncClient;
+
+    /**
+     * @brief ParallelRangeReader - reads one long tag interval as several concurrent sub-range reads
+     *
+     * read() first asks the server for the stored extent of the tag through QueryTagRange, clamps
+     * the requested interval to it and splits it into up to parts() sub-ranges of at least
+     * minimumSpan() msecs. The sub-ranges are read concurrently, each over its own connection,
+     * and concatenated in time order into one ReadTagHolder.
+     *
+     * Range replies carry only the tag name, so a connection serves at most one sub-range of a
+     * read and the number of sub-ranges is also bounded by the number of connections. With a
+     * single connection the interval is read in one piece.
+     *
+     * Sub-ranges do not overlap, both ends of a read are inclusive. Only raw samples are read,
+     * bucket aggregation does not survive the split.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC ParallelRangeReader : public QObject {
+        Q_OBJECT
+    public:
+        explicit ParallelRangeReader(AsyncClient* connection, QObject* parent = nullptr);
+        explicit ParallelRangeReader(const QVector<AsyncClient*>& connections, QObject* parent = nullptr);
+
+        void setParts(int parts);
+        int parts() const { return _parts; }
+        void setMinimumSpan(qint64 msecs);
+        qint64 minimumSpan() const { return _minimumSpan; }
+
+        // canceling the returned future cancels every outstanding sub-range read
+        QFuture<ReadTagHolder> read(const QString& tag, const QDateTime& from, const QDateTime& to);
+
+        // the sub-ranges read() splits [from, to] into
+        static QVector<QPair<qint64, qint64>> split(qint64 from, qint64 to, int parts, qint64 minimumSpan);
+
+    private:
+        struct Job;
+
+        void start(const std::shared_ptr<Job>& job, qint64 first, qint64 last);
+        void finish(const std::shared_ptr<Job>& job);
+        void cancel(const std::shared_ptr<Job>& job);
+
+        QVector<AsyncClient*> _connections;
+        int _next = 0;
+        int _parts = 8;
+        qint64 _minimumSpan = 60000;
+    };
+}
@@ -0,0 +1,323 @@
+#include "edhprefetch.h"
+#include "edhasync.h"
+#include "edhclient.h"
+#include "edhrangeplanner.h"
+
+#include <QFutureInterface>
+#include <QFutureWatcher>
+
+#include <algorithm>
+#include <limits>
+
+using namespace eDrillingHub;
+
+struct HistoryPrefetcher::Window {
+    qint64 from, to;
+    ReadTagHolder data;
+    quint64 used;
+};
+
+struct HistoryPrefetcher::Fetch {
+    struct Waiter {
+        QFutureInterface<ReadTagHolder> promise;
+        qint64 from, to;
+    };
+
+    qint64 from, to;
+    // server time when the read was sent, data later than this did not exist yet; -1 when unknown
+    qint64 issued;
+    bool background;
+    QFuture<ReadTagHolder> read;
+    QList<Waiter> waiting;
+};
+
+HistoryPrefetcher::HistoryPrefetcher(AsyncClient *client, QObject *parent) :
+    QObject(parent),
+    _client(client)
+{
+}
+
+HistoryPrefetcher::~HistoryPrefetcher() {
+    for (const auto& fetches : _fetches) {
+        for (const auto& fetch : fetches) {
+            for (auto& waiter : fetch->waiting) {
+                waiter.promise.reportCanceled();
+                waiter.promise.reportFinished();
+            }
+        }
+    }
+}
+
+void HistoryPrefetcher::setCapacity(qint64 samples) {
+    _capacity = std::max<qint64>(samples, 0);
+    evict();
+}
+
+void HistoryPrefetcher::setLookahead(int windows) {
+    _lookahead = std::max(windows, 0);
+}
+
+QFuture<ReadTagHolder> HistoryPrefetcher::read(const QString &tag, const QDateTime &from, const QDateTime &to, Direction direction) {
+    qint64 first = from.toMSecsSinceEpoch();
+    qint64 last = to.toMSecsSinceEpoch();
+
+    QFutureInterface<ReadTagHolder> promise;
+    promise.reportStarted();
+    QFuture<ReadTagHolder> result = promise.future();
+
+    dropStale(tag, first, last);
+
+    ReadTagHolder data;
+    if (assemble(tag, first, last, &data)) {
+        _hits++;
+        promise.reportResult(data);
+        promise.reportFinished();
+    } else {
+        _misses++;
+        // a prefetch may wait behind every normal request, the shown window does not join it
+        std::shared_ptr<Fetch> pending = fetching(tag, first, last);
+        if (! pending || pending->background) {
+            pending = fetch(tag, first, last, false);
+        }
+        pending->waiting.append(Fetch::Waiter{promise, first, last});
+    }
+
+    prefetch(tag, first, last, direction);
+    return result;
+}
+
+bool HistoryPrefetcher::covers(const QString &tag, qint64 from, qint64 to) const {
+    return plan(tag, from, to, nullptr);
+}
+
+void HistoryPrefetcher::clear() {
+    _windows.clear();
+    _samples = 0;
+}
+
+bool HistoryPrefetcher::plan(const QString &tag, qint64 from, qint64 to, QList<QPair<Window*, qint64>> *pieces) const {
+    auto windows = _windows.find(tag);
+    if (windows == _windows.end() || to < from) {
+        return false;
+    }
+
+    // greedy interval cover, always continuing with the window reaching furthest
+    qint64 cursor = from;
+    while (true) {
+        Window* best = nullptr;
+        for (const auto& window : windows.value()) {
+            if (window->from <= cursor && window->to >= cursor && (! best || window->to > best->to)) {
+                best = window.get();
+            }
+        }
+        if (! best) {
+            return false;
+        }
+
+        qint64 end = std::min(best->to, to);
+        if (pieces) {
+            pieces->append(qMakePair(best, end));
+        }
+        if (end == to) {
+            return true;
+        }
+        cursor = end + 1;
+    }
+}
+
+bool HistoryPrefetcher::assemble(const QString &tag, qint64 from, qint64 to, ReadTagHolder *data) {
+    QList<QPair<Window*, qint64>> pieces;
+    if (! plan(tag, from, to, &pieces)) {
+        return false;
+    }
+
+    if (pieces.size() == 1) {
+        pieces.first().first->used = ++_clock;
+        *data = RangeReadPlanner::slice(pieces.first().first->data, from, to);
+        return true;
+    }
+
+    data->from = QDateTime::fromMSecsSinceEpoch(from).toUTC();
+    data->to = QDateTime::fromMSecsSinceEpoch(to).toUTC();
+    qint64 cursor = from;
+    for (const auto& piece : pieces) {
+        piece.first->used = ++_clock;
+        ReadTagHolder part = RangeReadPlanner::slice(piece.first->data, cursor, piece.second);
+        data->timestamps.append(part.timestamps);
+        data->values.append(part.values);
+        cursor = piece.second + 1;
+    }
+    return true;
+}
+
+std::shared_ptr<HistoryPrefetcher::Fetch> HistoryPrefetcher::fetching(const QString &tag, qint64 from, qint64 to) const {
+    std::shared_ptr<Fetch> found;
+    for (const auto& pending : _fetches.value(tag)) {
+        if (pending->read.isCanceled()) {
+            continue;
+        }
+        if (pending->from <= from && to <= pending->to && (! found || found->background)) {
+            found = pending;
+        }
+    }
+    return found;
+}
+
+std::shared_ptr<HistoryPrefetcher::Fetch> HistoryPrefetcher::fetch(const QString &tag, qint64 from, qint64 to, bool background) {
+    auto pending = std::make_shared<Fetch>();
+    pending->from = from;
+    pending->to = to;
+    pending->issued = serverTime(-1);
+    pending->background = background;
+    pending->read = _client->readTagRange(tag, QDateTime::fromMSecsSinceEpoch(from, Qt::UTC), QDateTime::fromMSecsSinceEpoch(to, Qt::UTC),
+                                          Aggregation(), background ? AsyncClient::Priority::Background : AsyncClient::Priority::Normal);
+    _fetches[tag].append(pending);
+
+    auto watcher = new QFutureWatcher<ReadTagHolder>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, tag, pending, watcher] {
+        watcher->deleteLater();
+
+        auto fetches = _fetches.find(tag);
+        if (fetches != _fetches.end()) {
+            fetches.value().removeOne(pending);
+            if (fetches.value().isEmpty()) {
+                _fetches.erase(fetches);
+            }
+        }
+
+        bool canceled = pending->read.isCanceled();
+        ReadTagHolder data;
+        if (! canceled) {
+            data = pending->read.result();
+            // without the server clock only what is known to be complete, up to the last sample, is cached
+            qint64 complete = pending->issued;
+            if (complete < 0) {
+                complete = data.timestamps.isEmpty() ? pending->from - 1 : data.timestamps.last().toMSecsSinceEpoch();
+            }
+            store(tag, pending->from, std::min(pending->to, complete), data);
+        }
+
+        for (auto& waiter : pending->waiting) {
+            if (canceled) {
+                waiter.promise.reportCanceled();
+            } else if (! waiter.promise.isCanceled()) {
+                waiter.promise.reportResult(RangeReadPlanner::slice(data, waiter.from, waiter.to));
+            }
+            waiter.promise.reportFinished();
+        }
+    });
+    watcher->setFuture(pending->read);
+
+    return pending;
+}
+
+void HistoryPrefetcher::prefetch(const QString &tag, qint64 from, qint64 to, Direction direction) {
+    qint64 span = to - from + 1;
+    if (span <= 0 || direction == Direction::None) {
+        return;
+    }
+
+    qint64 now = serverTime(QDateTime::currentMSecsSinceEpoch());
+    for (int i = 0; i < _lookahead; i++) {
+        if (direction == Direction::Forward || direction == Direction::Both) {
+            qint64 first = to + 1 + i * span;
+            qint64 last = first + span - 1;
+            // nothing to read ahead of the present
+            if (first <= now && ! covers(tag, first, last) && ! fetching(tag, first, last)) {
+                fetch(tag, first, last, true);
+            }
+        }
+        if (direction == Direction::Backward || direction == Direction::Both) {
+            qint64 last = from - 1 - i * span;
+            qint64 first = last - span + 1;
+            if (! covers(tag, first, last) && ! fetching(tag, first, last)) {
+                fetch(tag, first, last, true);
+            }
+        }
+    }
+}
+
+void HistoryPrefetcher::dropStale(const QString &tag, qint64 from, qint64 to) {
+    auto fetches = _fetches.find(tag);
+    if (fetches == _fetches.end()) {
+        return;
+    }
+
+    // background reads beyond the lookahead of the window now shown are no longer wanted
+    qint64 reach = qint64(_lookahead) * (to - from + 1);
+    QList<std::shared_ptr<Fetch>>& pending = fetches.value();
+    for (int i = pending.size() - 1; i >= 0; i--) {
+        const std::shared_ptr<Fetch>& stale = pending[i];
+        if (! stale->background || ! stale->waiting.isEmpty()) {
+            continue;
+        }
+        if (stale->to >= from - reach && stale->from <= to + reach) {
+            continue;
+        }
+        stale->read.cancel();
+        pending.removeAt(i);
+    }
+    if (pending.isEmpty()) {
+        _fetches.erase(fetches);
+    }
+}
+
+qint64 HistoryPrefetcher::serverTime(qint64 unknown) const {
+    LatencyTracker* latency = _client->client()->latency();
+    if (! latency || ! latency->hasClockOffset()) {
+        return unknown;
+    }
+    return QDateTime::currentMSecsSinceEpoch() + latency->clockOffset();
+}
+
+void HistoryPrefetcher::store(const QString &tag, qint64 from, qint64 to, const ReadTagHolder &data) {
+    if (to < from) {
+        return;
+    }
+
+    QList<std::shared_ptr<Window>>& windows = _windows[tag];
+    for (int i = windows.size() - 1; i >= 0; i--) {
+        if (from <= windows[i]->from && windows[i]->to <= to) {
+            _samples -= windows[i]->data.timestamps.size();
+            windows.removeAt(i);
+        }
+    }
+
+    auto window = std::make_shared<Window>();
+    window->from = from;
+    window->to = to;
+    window->data = RangeReadPlanner::slice(data, from, to);
+    window->used = ++_clock;
+    _samples += window->data.timestamps.size();
+    windows.append(window);
+
+    evict();
+}
+
+void HistoryPrefetcher::evict() {
+    while (_samples > _capacity) {
+        QString oldestTag;
+        int oldest = -1;
+        quint64 used = std::numeric_limits<quint64>::max();
+
+        for (auto it = _windows.cbegin(); it != _windows.cend(); ++it) {
+            for (int i = 0; i < it.value().size(); i++) {
+                if (it.value()[i]->used < used) {
+                    used = it.value()[i]->used;
+                    oldestTag = it.key();
+                    oldest = i;
+                }
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+
+        QList<std::shared_ptr<Window>>& windows = _windows[oldestTag];
+        _samples -= windows[oldest]->data.timestamps.size();
+        windows.removeAt(oldest);
+        if (windows.isEmpty()) {
+            _windows.remove(oldestTag);
+        }
+    }
+}
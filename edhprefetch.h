@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QObject>
+#include <QFuture>
+#include <QHash>
+#include <QPair>
+#include <memory>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+
+namespace eDrillingHub {
+    class AsyncClient;
+
+    /**
+     * @brief HistoryPrefetcher - serves chart windows from memory and reads the neighbours ahead
+     *
+     * read() answers from the cached windows of the tag when they cover the requested interval,
+     * stitching adjacent windows together, or joins a read already in flight for it; otherwise
+     * the window is read from the server. Afterwards lookahead() windows of the same span are
+     * requested on the scroll direction side(s) as background reads, so the next pan or
+     * zoom-out finds them cached. Zooming in is served from the window already shown.
+     * Background reads that no longer neighbour the window shown are canceled.
+     *
+     * The part of a window past the server's present is not cached. The present comes from
+     * the clock offset of the client's latency tracking; without it a window is cached only
+     * up to its last sample.
+     *
+     * The cache is bounded by capacity() samples over all tags, least recently used windows are
+     * evicted first.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC HistoryPrefetcher : public QObject {
+        Q_OBJECT
+    public:
+        enum class Direction {
+            None,
+            Forward,
+            Backward,
+            Both
+        };
+        Q_ENUM(Direction)
+
+        explicit HistoryPrefetcher(AsyncClient* client, QObject* parent = nullptr);
+        virtual ~HistoryPrefetcher();
+
+        void setCapacity(qint64 samples);
+        qint64 capacity() const { return _capacity; }
+        void setLookahead(int windows);
+        int lookahead() const { return _lookahead; }
+
+        QFuture<ReadTagHolder> read(const QString& tag, const QDateTime& from, const QDateTime& to, Direction direction = Direction::Both);
+
+        bool covers(const QString& tag, qint64 from, qint64 to) const;
+        qint64 cachedSamples() const { return _samples; }
+        void clear();
+
+        quint64 hits() const { return _hits; }
+        quint64 misses() const { return _misses; }
+
+    private:
+        struct Window;
+        struct Fetch;
+
+        // the windows covering [from, to] in time order, each with the end of the part taken from it
+        bool plan(const QString& tag, qint64 from, qint64 to, QList<QPair<Window*, qint64>>* pieces) const;
+        bool assemble(const QString& tag, qint64 from, qint64 to, ReadTagHolder* data);
+        // a normal read covering [from, to] when there is one, otherwise a background one
+        std::shared_ptr<Fetch> fetching(const QString& tag, qint64 from, qint64 to) const;
+        std::shared_ptr<Fetch> fetch(const QString& tag, qint64 from, qint64 to, bool background);
+        void prefetch(const QString& tag, qint64 from, qint64 to, Direction direction);
+        // cancels the background reads of tag that no longer neighbour [from, to]
+        void dropStale(const QString& tag, qint64 from, qint64 to);
+        // now on the server clock, from the offset the client's latency tracking estimates
+        qint64 serverTime(qint64 unknown) const;
+        void store(const QString& tag, qint64 from, qint64 to, const ReadTagHolder& data);
+        void evict();
+
+        AsyncClient* _client;
+        qint64 _capacity = 2000000;
+        int _lookahead = 1;
+
+        QHash<QString, QList<std::shared_ptr<Window>>> _windows;
+        QHash<QString, QList<std::shared_ptr<Fetch>>> _fetches;
+        qint64 _samples = 0;
+        quint64 _clock = 0;
+
+        quint64 _hits = 0;
+        quint64 _misses = 0;
+    };
+}
@@ -8,6 +8,7 @@
 
 #include "file_session.h"
 #include "serialization.h"
+#include "edhencoder.h"
 
 QString eDrillingHub::Protocol::WriteTag(const QString& tagName, const QDateTime& timestamp, const QVariant& value) {
     auto serialized = Serialization::serialize(value);
@@ -26,21 +27,19 @@ QString eDrillingHub::Protocol::SubscribeTag(const QString &tag) {
     return SubscribeTagTemplate.arg(tag);
 }
 
+QString eDrillingHub::Protocol::UnsubscribeTag(const QString &tag) {
+    return UnsubscribeTagTemplate.arg(tag);
+}
+
 QString eDrillingHub::Protocol::SwitchSession(const QString &sessionName) {
     return QString("session|switch|%1").arg(sessionName);
 }
 
 QString eDrillingHub::Protocol::Configuration(ServerConfiguration::Operation operation, ServerConfiguration::Target target, ServerConfiguration::Command command, const QString &targetTag) {
-    QStringList msg;
-
-    msg += "config";
-    QString operationString = QMetaEnum::fromType<ServerConfiguration::Operation>().valueToKey(static_cast<int>(operation));
-    msg += operationString.remove(ServerConfiguration().getOperationPrefix());
-    msg += QMetaEnum::fromType<ServerConfiguration::Target>().valueToKey(static_cast<int>(target));
-    msg += QMetaEnum::fromType<ServerConfiguration::Command>().valueToKey(static_cast<int>(command));
-    msg += targetTag;
-
-    return msg.join("|");
+    // the encoder keeps the enum keys precomputed instead of asking QMetaEnum every time
+    QByteArray line;
+    CommandEncoder(&line).configuration(operation, target, command, targetTag);
+    return QString::fromUtf8(line.constData(), line.size() - 2);
 }
 
 QString eDrillingHub::Protocol::ReadTagRange(const QString &tag, QDateTime aStart, QDateTime aEnd) {
@@ -55,7 +54,7 @@ QString eDrillingHub::Protocol::FileTransfer(const QString &filename) {
     return QString("file|transfer|%1").arg(filename);
 }
 QString eDrillingHub::Protocol::FileUploadRequest(const QString &filename, qint64 size) {
-    return QString("file|upload|%1|%2").arg(filename, QString::number(size)).toUtf8();
+    return QString("file|upload|%1|%2").arg(filename, QString::number(size));
 }
 QString eDrillingHub::Protocol::FileUploadTransfer(std::shared_ptr<UploadSession> session, std::function<void(const QByteArray&)> transfer_fn) {
     qint64 transferred = 0;
@@ -69,7 +68,7 @@ QString eDrillingHub::Protocol::FileUploadTransfer(std::shared_ptr<UploadSession
         session->progress(transferred);
     }
 
-    return QString("file|upload|done|%1").arg(QString(hash.result().toHex())).toUtf8();
+    return QString("file|upload|done|%1").arg(QString::fromLatin1(hash.result().toHex()));
 }
 
 QString eDrillingHub::Protocol::QueryTagRange(const QString &tag) {
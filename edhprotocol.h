@@ -65,11 +65,13 @@ namespace eDrillingHub {
         const QString BrowseCommand = "browse";
         const QString ReadTagTemplate = "read|%1";
         const QString SubscribeTagTemplate = "subscribe|%1";
+        const QString UnsubscribeTagTemplate = "unsubscribe|%1";
 
         QString EXPORT_LIBEDRILLINGHUB_SPEC ReadTag(const QString &tag);
         QString EXPORT_LIBEDRILLINGHUB_SPEC ReadTagRange(const QString &tag, QDateTime aStart, QDateTime aEnd);
         QString EXPORT_LIBEDRILLINGHUB_SPEC QueryTagRange(const QString &tag);
         QString EXPORT_LIBEDRILLINGHUB_SPEC SubscribeTag(const QString &tag);
+        QString EXPORT_LIBEDRILLINGHUB_SPEC UnsubscribeTag(const QString &tag);
         QString EXPORT_LIBEDRILLINGHUB_SPEC WriteTag(const QString& tagName, const QDateTime& timestamp, const QVariant& value);
         QString EXPORT_LIBEDRILLINGHUB_SPEC SwitchSession(const QString &sessionName);
         QString EXPORT_LIBEDRILLINGHUB_SPEC Configuration(ServerConfiguration::Operation operation, ServerConfiguration::Target target, ServerConfiguration::Command command, const QString &targetTag);
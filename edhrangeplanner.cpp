@@ -0,0 +1,232 @@
+#include "edhrangeplanner.h"
+#include "edhasync.h"
+
+#include <QFutureInterface>
+#include <QFutureWatcher>
+
+#include <algorithm>
+
+using namespace eDrillingHub;
+
+struct RangeReadPlanner::Requester {
+    QFutureInterface<ReadTagHolder> promise;
+    QString tag;
+    qint64 from, to;
+    // set once the read is part of a server read
+    std::weak_ptr<Batch> batch;
+    bool done = false;
+};
+
+struct RangeReadPlanner::Batch {
+    QString tag;
+    qint64 from, to;
+    QFuture<ReadTagHolder> read;
+    QList<std::shared_ptr<Requester>> requesters;
+};
+
+RangeReadPlanner::RangeReadPlanner(AsyncClient *client, QObject *parent) :
+    QObject(parent),
+    _client(client)
+{
+    _timer.setSingleShot(true);
+    connect(&_timer, &QTimer::timeout, this, &RangeReadPlanner::flush);
+}
+
+RangeReadPlanner::~RangeReadPlanner() {
+    QList<std::shared_ptr<Requester>> requesters;
+    for (const auto& pending : _pending) {
+        requesters.append(pending);
+    }
+    for (const auto& batches : _inFlight) {
+        for (const auto& batch : batches) {
+            batch->read.cancel();
+            requesters.append(batch->requesters);
+        }
+    }
+
+    for (const auto& requester : requesters) {
+        if (! requester->done) {
+            requester->done = true;
+            requester->promise.reportCanceled();
+            requester->promise.reportFinished();
+        }
+    }
+}
+
+void RangeReadPlanner::setWindow(int msecs) {
+    _window = std::max(msecs, 0);
+}
+
+void RangeReadPlanner::setMaxGap(qint64 msecs) {
+    _maxGap = std::max<qint64>(msecs, 0);
+}
+
+QFuture<ReadTagHolder> RangeReadPlanner::read(const QString &tag, const QDateTime &from, const QDateTime &to) {
+    auto requester = std::make_shared<Requester>();
+    requester->promise.reportStarted();
+    requester->tag = tag;
+    requester->from = from.toMSecsSinceEpoch();
+    requester->to = to.toMSecsSinceEpoch();
+    QFuture<ReadTagHolder> result = requester->promise.future();
+    _requested++;
+
+    auto watcher = new QFutureWatcher<ReadTagHolder>(this);
+    connect(watcher, &QFutureWatcherBase::canceled, this, [this, requester] {
+        detach(requester);
+    });
+    connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(result);
+
+    for (const auto& batch : _inFlight.value(tag)) {
+        if (batch->from <= requester->from && requester->to <= batch->to) {
+            batch->requesters.append(requester);
+            requester->batch = batch;
+            return result;
+        }
+    }
+
+    _pending[tag].append(requester);
+    if (! _timer.isActive()) {
+        _timer.start(_window);
+    }
+    return result;
+}
+
+void RangeReadPlanner::flush() {
+    QHash<QString, QList<std::shared_ptr<Requester>>> pending;
+    std::swap(pending, _pending);
+
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        QList<std::shared_ptr<Requester>>& requesters = it.value();
+        std::sort(requesters.begin(), requesters.end(), [](const std::shared_ptr<Requester>& a, const std::shared_ptr<Requester>& b) {
+            return a->from < b->from;
+        });
+
+        QList<std::shared_ptr<Requester>> group;
+        qint64 from = 0, to = 0;
+        for (const auto& requester : requesters) {
+            if (requester->done) {
+                continue;
+            }
+            if (! group.isEmpty() && requester->from > to + 1 + _maxGap) {
+                issue(it.key(), from, to, group);
+                group.clear();
+            }
+            if (group.isEmpty()) {
+                from = requester->from;
+                to = requester->to;
+            }
+            to = std::max(to, requester->to);
+            group.append(requester);
+        }
+        if (! group.isEmpty()) {
+            issue(it.key(), from, to, group);
+        }
+    }
+}
+
+void RangeReadPlanner::issue(const QString &tag, qint64 from, qint64 to, const QList<std::shared_ptr<Requester>> &requesters) {
+    auto batch = std::make_shared<Batch>();
+    batch->tag = tag;
+    batch->from = from;
+    batch->to = to;
+    batch->requesters = requesters;
+    batch->read = _client->readTagRange(tag, QDateTime::fromMSecsSinceEpoch(from, Qt::UTC), QDateTime::fromMSecsSinceEpoch(to, Qt::UTC));
+    for (const auto& requester : requesters) {
+        requester->batch = batch;
+    }
+    _inFlight[tag].append(batch);
+    _issued++;
+
+    auto watcher = new QFutureWatcher<ReadTagHolder>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, batch, watcher] {
+        watcher->deleteLater();
+        complete(batch);
+    });
+    watcher->setFuture(batch->read);
+}
+
+void RangeReadPlanner::detach(const std::shared_ptr<Requester> &requester) {
+    if (requester->done) {
+        return;
+    }
+    requester->done = true;
+    requester->promise.reportFinished();
+
+    std::shared_ptr<Batch> batch = requester->batch.lock();
+    if (! batch) {
+        auto pending = _pending.find(requester->tag);
+        if (pending != _pending.end()) {
+            pending.value().removeOne(requester);
+            if (pending.value().isEmpty()) {
+                _pending.erase(pending);
+            }
+        }
+        return;
+    }
+
+    batch->requesters.removeOne(requester);
+    if (batch->requesters.isEmpty()) {
+        // a read() before the canceled batch finishes must not join it
+        retire(batch);
+        batch->read.cancel();
+    }
+}
+
+void RangeReadPlanner::retire(const std::shared_ptr<Batch> &batch) {
+    auto batches = _inFlight.find(batch->tag);
+    if (batches != _inFlight.end()) {
+        batches.value().removeOne(batch);
+        if (batches.value().isEmpty()) {
+            _inFlight.erase(batches);
+        }
+    }
+}
+
+void RangeReadPlanner::complete(const std::shared_ptr<Batch> &batch) {
+    retire(batch);
+
+    bool canceled = batch->read.isCanceled();
+    ReadTagHolder data;
+    if (! canceled) {
+        data = batch->read.result();
+    }
+
+    for (const auto& requester : batch->requesters) {
+        if (requester->done) {
+            continue;
+        }
+        requester->done = true;
+        if (canceled) {
+            requester->promise.reportCanceled();
+        } else {
+            requester->promise.reportResult(slice(data, requester->from, requester->to));
+        }
+        requester->promise.reportFinished();
+    }
+}
+
+ReadTagHolder RangeReadPlanner::slice(const ReadTagHolder &data, qint64 from, qint64 to) {
+    ReadTagHolder part;
+    part.from = QDateTime::fromMSecsSinceEpoch(from).toUTC();
+    part.to = QDateTime::fromMSecsSinceEpoch(to).toUTC();
+
+    auto begin = data.timestamps.constBegin();
+    auto end = data.timestamps.constEnd();
+    int first = int(std::lower_bound(begin, end, from, [](const QDateTime& ts, qint64 value) {
+        return ts.toMSecsSinceEpoch() < value;
+    }) - begin);
+    int last = int(std::upper_bound(begin, end, to, [](qint64 value, const QDateTime& ts) {
+        return value < ts.toMSecsSinceEpoch();
+    }) - begin);
+
+    if (first == 0 && last == data.timestamps.size()) {
+        // the whole result, shared instead of copied
+        part.timestamps = data.timestamps;
+        part.values = data.values;
+    } else if (last > first) {
+        part.timestamps = data.timestamps.mid(first, last - first);
+        part.values = data.values.mid(first, last - first);
+    }
+    return part;
+}
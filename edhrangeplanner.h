@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QObject>
+#include <QFuture>
+#include <QHash>
+#include <QTimer>
+#include <memory>
+
+#include "edhtypes.h"
+#include "edhprotocol.h"
+
+namespace eDrillingHub {
+    class AsyncClient;
+
+    /**
+     * @brief RangeReadPlanner - merges overlapping range reads of a tag into one server read
+     *
+     * Reads are held for window() msecs (0 waits for the next event loop pass), then the held
+     * reads of each tag are sorted and every run of overlapping or adjacent intervals, up to
+     * maxGap() msecs apart, becomes one ReadTagRange. A read that falls inside a server read
+     * already in flight joins it instead. Each requester receives the slice of the merged
+     * result covering its own interval.
+     *
+     * Canceling a future detaches its requester, a server read nobody waits for is canceled.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC RangeReadPlanner : public QObject {
+        Q_OBJECT
+    public:
+        explicit RangeReadPlanner(AsyncClient* client, QObject* parent = nullptr);
+        virtual ~RangeReadPlanner();
+
+        void setWindow(int msecs);
+        int window() const { return _window; }
+        void setMaxGap(qint64 msecs);
+        qint64 maxGap() const { return _maxGap; }
+
+        QFuture<ReadTagHolder> read(const QString& tag, const QDateTime& from, const QDateTime& to);
+
+        quint64 requested() const { return _requested; }
+        quint64 issued() const { return _issued; }
+
+        // the samples of data within [from, to], data must be sorted by time
+        static ReadTagHolder slice(const ReadTagHolder& data, qint64 from, qint64 to);
+
+    private:
+        struct Requester;
+        struct Batch;
+
+        void flush();
+        void issue(const QString& tag, qint64 from, qint64 to, const QList<std::shared_ptr<Requester>>& requesters);
+        void detach(const std::shared_ptr<Requester>& requester);
+        // removes batch from _inFlight so no further read() joins it
+        void retire(const std::shared_ptr<Batch>& batch);
+        void complete(const std::shared_ptr<Batch>& batch);
+
+        AsyncClient* _client;
+        int _window = 0;
+        qint64 _maxGap = 0;
+        QTimer _timer;
+
+        QHash<QString, QList<std::shared_ptr<Requester>>> _pending;
+        QHash<QString, QList<std::shared_ptr<Batch>>> _inFlight;
+
+        quint64 _requested = 0;
+        quint64 _issued = 0;
+    };
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <QVector>
+#include <QMetaType>
+#include <QDataStream>
+
+#include <algorithm>
+
+#include "edhmatrix.h"
+
+namespace eDrillingHub {
+    // rows accepted from the wire, a sparse matrix costs one row offset per row however few entries it has
+    const qint32 SparseMatrixMaxRows = 1 << 24;
+
+    /**
+     * @brief SparseMatrix - compressed sparse row matrix
+     *
+     * Only elements different from T() are stored. Row r owns the entries
+     * [rowOffsets()[r], rowOffsets()[r + 1]) of columnIndices() and values(), sorted by column.
+     */
+    template <typename T>
+    class SparseMatrix {
+    public:
+        struct Entry {
+            qint32 row;
+            qint32 column;
+            T value;
+        };
+
+        SparseMatrix();
+        SparseMatrix(qint32 rows, qint32 columns);
+
+        static SparseMatrix fromMatrix(const Matrix<T>& matrix);
+        // later entries win over earlier ones at the same position, entries out of range are dropped
+        static SparseMatrix fromEntries(qint32 rows, qint32 columns, QVector<Entry> entries);
+        Matrix<T> toMatrix() const;
+        QVector<Entry> entries() const;
+
+        qint32 rows() const { return _rows; }
+        qint32 columns() const { return _columns; }
+        qint32 nonZeros() const { return _values.size(); }
+        double density() const;
+
+        // T() for elements that are not stored
+        T value(qint32 row, qint32 column) const;
+
+        const QVector<qint32>& rowOffsets() const { return _rowOffsets; }
+        const QVector<qint32>& columnIndices() const { return _columnIndices; }
+        const QVector<T>& values() const { return _values; }
+
+        bool operator==(const SparseMatrix& other) const;
+        bool operator!=(const SparseMatrix& other) const { return ! operator==(other); }
+
+    private:
+        qint32 _rows, _columns;
+        QVector<qint32> _rowOffsets;
+        QVector<qint32> _columnIndices;
+        QVector<T> _values;
+    };
+
+    template <typename T>
+    SparseMatrix<T>::SparseMatrix() :
+        SparseMatrix(0, 0)
+    {
+    }
+
+    template <typename T>
+    SparseMatrix<T>::SparseMatrix(qint32 rows, qint32 columns) :
+        _rows(rows),
+        _columns(columns),
+        _rowOffsets(rows + 1, 0)
+    {
+    }
+
+    template <typename T>
+    SparseMatrix<T> SparseMatrix<T>::fromMatrix(const Matrix<T> &matrix) {
+        SparseMatrix<T> sparse(matrix.rows(), matrix.columns());
+        const T zero = T();
+
+        for (qint32 r = 0; r < matrix.rows(); r++) {
+            for (qint32 c = 0; c < matrix.columns(); c++) {
+                const T& v = matrix(r, c);
+                if (! (v == zero)) {
+                    sparse._columnIndices.append(c);
+                    sparse._values.append(v);
+                }
+            }
+            sparse._rowOffsets[r + 1] = sparse._values.size();
+        }
+
+        return sparse;
+    }
+
+    template <typename T>
+    SparseMatrix<T> SparseMatrix<T>::fromEntries(qint32 rows, qint32 columns, QVector<Entry> entries) {
+        SparseMatrix<T> sparse(rows, columns);
+        const T zero = T();
+
+        // a stable sort keeps the input order among duplicates so the last one can win
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.row < b.row || (a.row == b.row && a.column < b.column);
+        });
+
+        sparse._columnIndices.reserve(entries.size());
+        sparse._values.reserve(entries.size());
+        for (int i = 0; i < entries.size(); i++) {
+            const Entry& e = entries[i];
+            if (e.row < 0 || e.row >= rows || e.column < 0 || e.column >= columns) {
+                continue;
+            }
+            if (i + 1 < entries.size() && entries[i + 1].row == e.row && entries[i + 1].column == e.column) {
+                continue;
+            }
+            if (e.value == zero) {
+                continue;
+            }
+
+            sparse._columnIndices.append(e.column);
+            sparse._values.append(e.value);
+            sparse._rowOffsets[e.row + 1]++;
+        }
+
+        for (qint32 r = 0; r < rows; r++) {
+            sparse._rowOffsets[r + 1] += sparse._rowOffsets[r];
+        }
+
+        return sparse;
+    }
+
+    template <typename T>
+    Matrix<T> SparseMatrix<T>::toMatrix() const {
+        Matrix<T> matrix;
+        matrix.size(_rows, _columns);
+
+        for (qint32 r = 0; r < _rows; r++) {
+            for (qint32 i = _rowOffsets[r]; i < _rowOffsets[r + 1]; i++) {
+                matrix(r, _columnIndices[i]) = _values[i];
+            }
+        }
+
+        return matrix;
+    }
+
+    template <typename T>
+    QVector<typename SparseMatrix<T>::Entry> SparseMatrix<T>::entries() const {
+        QVector<Entry> entries;
+        entries.reserve(_values.size());
+
+        for (qint32 r = 0; r < _rows; r++) {
+            for (qint32 i = _rowOffsets[r]; i < _rowOffsets[r + 1]; i++) {
+                entries.append(Entry{r, _columnIndices[i], _values[i]});
+            }
+        }
+
+        return entries;
+    }
+
+    template <typename T>
+    double SparseMatrix<T>::density() const {
+        qint64 size = qint64(_rows) * _columns;
+        return size == 0 ? 0 : double(_values.size()) / size;
+    }
+
+    template <typename T>
+    T SparseMatrix<T>::value(qint32 row, qint32 column) const {
+        auto begin = _columnIndices.constBegin() + _rowOffsets[row];
+        auto end = _columnIndices.constBegin() + _rowOffsets[row + 1];
+        auto it = std::lower_bound(begin, end, column);
+
+        if (it == end || *it != column) {
+            return T();
+        }
+        return _values[int(it - _columnIndices.constBegin())];
+    }
+
+    template <typename T>
+    bool SparseMatrix<T>::operator==(const SparseMatrix &other) const {
+        return _rows == other._rows && _columns == other._columns &&
+               _rowOffsets == other._rowOffsets && _columnIndices == other._columnIndices && _values == other._values;
+    }
+
+    template <typename T>
+    QDataStream& operator>>(QDataStream& s, SparseMatrix<T>& m) {
+        qint32 rows, columns, count;
+        s >> rows >> columns >> count;
+
+        m = SparseMatrix<T>();
+        if (s.status() != QDataStream::Ok) {
+            return s;
+        }
+        if (rows < 0 || columns < 0 || rows > SparseMatrixMaxRows || count < 0 || count > qint64(rows) * columns) {
+            s.setStatus(QDataStream::ReadCorruptData);
+            return s;
+        }
+
+        // grows with the entries actually read, count alone does not decide the allocation
+        QVector<typename SparseMatrix<T>::Entry> entries;
+        entries.reserve(qMin(count, 4096));
+        for (qint32 i = 0; i < count; i++) {
+            typename SparseMatrix<T>::Entry e;
+            s >> e.row >> e.column >> e.value;
+            if (s.status() != QDataStream::Ok) {
+                return s;
+            }
+            entries.append(e);
+        }
+
+        m = SparseMatrix<T>::fromEntries(rows, columns, entries);
+        return s;
+    }
+
+    template <typename T>
+    QDataStream& operator<<(QDataStream& s, const SparseMatrix<T>& m) {
+        s << m.rows() << m.columns() << m.nonZeros();
+
+        for (const auto& e : m.entries()) {
+            s << e.row << e.column << e.value;
+        }
+
+        return s;
+    }
+}
+
+Q_DECLARE_METATYPE(eDrillingHub::SparseMatrix<bool>)
+Q_DECLARE_METATYPE(eDrillingHub::SparseMatrix<int>)
+Q_DECLARE_METATYPE(eDrillingHub::SparseMatrix<qint64>)
+Q_DECLARE_METATYPE(eDrillingHub::SparseMatrix<double>)
@@ -0,0 +1,58 @@
+#include "edhsubscriptions.h"
+#include "edhclient.h"
+
+#include <QDebug>
+
+using namespace eDrillingHub;
+
+SubscriptionManager::SubscriptionManager(Client *client) :
+    _client(client)
+{
+}
+
+void SubscriptionManager::acquire(const QString &tag) {
+    acquire(QStringList(tag));
+}
+
+void SubscriptionManager::acquire(const QStringList &tags) {
+    QStringList added;
+
+    for (const auto& tag : tags) {
+        int& count = _counts[tag];
+        if (count++ == 0) {
+            added.append(tag);
+        }
+    }
+
+    if (! added.isEmpty()) {
+        _client->subscribe(added);
+    }
+}
+
+void SubscriptionManager::release(const QString &tag) {
+    release(QStringList(tag));
+}
+
+void SubscriptionManager::release(const QStringList &tags) {
+    QStringList removed;
+
+    for (const auto& tag : tags) {
+        auto it = _counts.find(tag);
+        if (it == _counts.end()) {
+            qWarning() << "SubscriptionManager: release of" << tag << "without acquire";
+            continue;
+        }
+        if (--it.value() == 0) {
+            _counts.erase(it);
+            removed.append(tag);
+        }
+    }
+
+    if (! removed.isEmpty()) {
+        _client->unsubscribe(removed);
+    }
+}
+
+void SubscriptionManager::reset() {
+    _counts.clear();
+}
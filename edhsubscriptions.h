@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+
+#include "edhtypes.h"
+
+namespace eDrillingHub {
+    class Client;
+
+    /**
+     * @brief SubscriptionManager - reference counted subscriptions shared by several consumers
+     *
+     * Every acquire() of a tag must be paired with a release(). The first acquisition of a tag
+     * subscribes it, the last release unsubscribes it; tags newly acquired or released by one
+     * call go to the hub as one pipelined batch. Client::unsubscribeAll() drops all counts.
+     */
+    class EXPORT_LIBEDRILLINGHUB_SPEC SubscriptionManager {
+    public:
+        explicit SubscriptionManager(Client* client);
+
+        void acquire(const QString& tag);
+        void acquire(const QStringList& tags);
+        void release(const QString& tag);
+        void release(const QStringList& tags);
+
+        int count(const QString& tag) const { return _counts.value(tag); }
+        QStringList tags() const { return _counts.keys(); }
+
+        void reset();
+
+    private:
+        Client* _client;
+        QHash<QString, int> _counts;
+    };
+}
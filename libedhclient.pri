@@ -8,6 +8,24 @@ SOURCES += \
     $$PWD/edhclient.cpp \
     $$PWD/edhclient_socket.cpp \
     $$PWD/edhclient_ws.cpp \
+    $$PWD/edhhistorycache.cpp \
+    $$PWD/edhconflator.cpp \
+    $$PWD/edhaggregation.cpp \
+    $$PWD/edhclientpool.cpp \
+    $$PWD/edhlatency.cpp \
+    $$PWD/edhmetrics.cpp \
+    $$PWD/edhcapture.cpp \
+    $$PWD/edhkernels.cpp \
+    $$PWD/edhbitmatrix.cpp \
+    $$PWD/edhjournal.cpp \
+    $$PWD/edhencoder.cpp \
+    $$PWD/edhsubscriptions.cpp \
+    $$PWD/edhcatalog.cpp \
+    $$PWD/edhasync.cpp \
+    $$PWD/edhparallelread.cpp \
+    $$PWD/edhrangeplanner.cpp \
+    $$PWD/edhprefetch.cpp \
+    $$PWD/edhlivehistory.cpp \
     $$PWD/../../serialization.cpp \
     $$PWD/../../tag/quality.cpp \
     $$PWD/../../util.cpp \
@@ -17,6 +35,25 @@ HEADERS += \
     $$PWD/edhclient.h \
     $$PWD/edhclient_socket.h \
     $$PWD/edhclient_ws.h \
+    $$PWD/edhhistorycache.h \
+    $$PWD/edhconflator.h \
+    $$PWD/edhaggregation.h \
+    $$PWD/edhclientpool.h \
+    $$PWD/edhlatency.h \
+    $$PWD/edhmetrics.h \
+    $$PWD/edhcapture.h \
+    $$PWD/edhkernels.h \
+    $$PWD/edhbitmatrix.h \
+    $$PWD/edhsparsematrix.h \
+    $$PWD/edhjournal.h \
+    $$PWD/edhencoder.h \
+    $$PWD/edhsubscriptions.h \
+    $$PWD/edhcatalog.h \
+    $$PWD/edhasync.h \
+    $$PWD/edhparallelread.h \
+    $$PWD/edhrangeplanner.h \
+    $$PWD/edhprefetch.h \
+    $$PWD/edhlivehistory.h \
     $$PWD/../../serialization.h \
     $$PWD/../../tag/quality.h \
     $$PWD/../../util.h \
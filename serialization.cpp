@@ -7,9 +7,14 @@
 
 #include "tagvaluename.h"
 #include "timestampeddouble.h"
+#include "edhbitmatrix.h"
+#include "edhsparsematrix.h"
 
 using namespace eDrillingHub;
 
+// bounds each side of a bit matrix before the element count is checked against the payload
+static const int bit_matrix_max_dimension = 1 << 24;
+
 static QMetaEnum _qualityEnum() {
     static QMetaEnum _enum = QMetaEnum::fromType<Tag::Quality::Value>();
     return _enum;
@@ -18,9 +23,13 @@ static QMetaEnum _qualityEnum() {
 const QRegularExpression Serialization::HashListSplitter("(?<!\\\\)#", QRegularExpression::OptimizeOnFirstUsageOption);
 const QRegularExpression Serialization::CommandSplitter("(?<!\\\\)\\|", QRegularExpression::OptimizeOnFirstUsageOption);
 
+static bool parseBool(const QStringRef& str) {
+    return str.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0;
+}
+
 static void edhMatrixConvert(QVector<bool>& vector, const QStringList& array) {
     for (const QString& str : array) {
-        vector.append(str.toLower() == "true");
+        vector.append(parseBool(QStringRef(&str)));
     }
 }
 
@@ -42,13 +51,9 @@ static void edhMatrixConvert(QVector<qint64>& vector, const QStringList& array)
     }
 }
 
-static QString deserializeStringValue(const QString &str) {
-    return QString(str).replace("\\|", "|").replace("\\r\\n", "\r\n").replace("\\\\", "\\");
-}
-
 static void edhMatrixConvert(QVector<QString>& vector, const QStringList& array) {
     for (const QString& str : array) {
-        vector.append(deserializeStringValue(str));
+        vector.append(Serialization::unescape(str));
     }
 }
 
@@ -69,7 +74,7 @@ QString Serialization::edhMatrixToQString(const Matrix<T>& matrix) {
 
         for (qint32 i = 0; i < rows; i++) {
             for (qint32 j = 0; j < columns; j++) {
-                value.append(serializeScalar(matrix(i, j)).replace('#', "\\#"));
+                value.append(escape(scalarToString(matrix(i, j)), true));
                 value.append('#');
             }
         }
@@ -81,6 +86,64 @@ QString Serialization::edhMatrixToQString(const Matrix<T>& matrix) {
     return value;
 }
 
+/*
+ * EDHSparseMatrix#rows#columns#type#count#row#column#value#...
+ * lists the stored elements in row-major order, every other element is T().
+ */
+template <typename T>
+QString Serialization::sparseMatrixToQString(const SparseMatrix<T>& matrix) {
+    QString value = QString("EDHSparseMatrix#%1#%2#%3#%4").
+            arg(matrix.rows()).arg(matrix.columns()).arg(qMetaTypeId<T>()).arg(matrix.nonZeros());
+
+    for (const auto& e : matrix.entries()) {
+        value.append('#');
+        value.append(QString::number(e.row));
+        value.append('#');
+        value.append(QString::number(e.column));
+        value.append('#');
+        value.append(escape(scalarToString(e.value), true));
+    }
+
+    return value;
+}
+
+static void appendBit(QString& value, bool bit) {
+    value.append(bit ? QLatin1String("true#") : QLatin1String("false#"));
+}
+
+QString Serialization::bitMatrixToQString(const BitMatrix &matrix) {
+    QString value;
+
+    qint32 rows = matrix.rows();
+    qint32 columns = matrix.columns();
+    if (rows > 0 && columns > 0) {
+        value.reserve(32 + rows * columns * 6);
+        value.append(QString("EDHMatrix#%1#%2#%3#").arg(rows).arg(columns).arg(int(QMetaType::Bool)));
+        for (qint32 i = 0; i < rows; i++) {
+            for (qint32 j = 0; j < columns; j++) {
+                appendBit(value, matrix.testBit(i, j));
+            }
+        }
+        value.chop(1);
+    } else {
+        value.append(QString("EDHMatrix#0#0#%1#").arg(int(QMetaType::Bool)));
+    }
+
+    return value;
+}
+
+QString Serialization::bitVectorToQString(const BitVector &vector) {
+    QString value = QString("Vector#%1#%2#").arg(vector.size()).arg(int(QMetaType::Bool));
+    if (vector.size() > 0) {
+        value.reserve(value.size() + vector.size() * 6);
+        for (qint32 i = 0; i < vector.size(); i++) {
+            appendBit(value, vector.testBit(i));
+        }
+        value.chop(1);
+    }
+    return value;
+}
+
 template <template<typename> class container, typename type>
 QString Serialization::iterableToQString(const container<type> &ct) {
     int size = ct.size();
@@ -90,15 +153,15 @@ QString Serialization::iterableToQString(const container<type> &ct) {
     case 0:
         break;
     case 1:
-        value.append(serializeScalar(*ct.begin()).replace('#', "\\#"));
+        value.append(escape(scalarToString(*ct.begin()), true));
         break;
     default:
         auto last = std::end(ct) - 1;
         std::for_each(std::begin(ct), last, [&] (const type& v) {
-            value.append(serializeScalar(v).replace('#', "\\#"));
+            value.append(escape(scalarToString(v), true));
             value.append('#');
         });
-        value.append(serializeScalar(*last).replace('#', "\\#"));
+        value.append(escape(scalarToString(*last), true));
     }
 
     return value;
@@ -158,6 +221,18 @@ std::tuple<QString, QMetaType::Type> Serialization::serialize(const QVariant& va
                 value = iterableToQString(variant.value<QVector<QDateTime>>());
             } else if (userType == qMetaTypeId<QSet<QString>>()) {
                 value = iterableToQString(variant.value<QSet<QString>>());
+            } else if (userType == qMetaTypeId<SparseMatrix<bool>>()) {
+                value = sparseMatrixToQString(variant.value<SparseMatrix<bool>>());
+            } else if (userType == qMetaTypeId<SparseMatrix<int>>()) {
+                value = sparseMatrixToQString(variant.value<SparseMatrix<int>>());
+            } else if (userType == qMetaTypeId<SparseMatrix<qint64>>()) {
+                value = sparseMatrixToQString(variant.value<SparseMatrix<qint64>>());
+            } else if (userType == qMetaTypeId<SparseMatrix<double>>()) {
+                value = sparseMatrixToQString(variant.value<SparseMatrix<double>>());
+            } else if (userType == qMetaTypeId<BitMatrix>()) {
+                value = bitMatrixToQString(variant.value<BitMatrix>());
+            } else if (userType == qMetaTypeId<BitVector>()) {
+                value = bitVectorToQString(variant.value<BitVector>());
             } else if (userType == qMetaTypeId<TimestampedDoubles>()) {
                 value = QString("TimestampedDoubles");
             } else {
@@ -267,6 +342,49 @@ Matrix<T> Serialization::qStringToEDHMatrix(QStringList &list, bool &ok) {
     return Matrix<T>(vector, rows, columns);
 }
 
+template <typename T>
+SparseMatrix<T> Serialization::qStringToSparseMatrix(QStringList &list, bool &ok) {
+    if (list.size() < 5) {
+        qWarning() << "Dropping faulty EDHSparseMatrix";
+        ok = false;
+        return SparseMatrix<T>();
+    }
+
+    int rows = list[1].toInt();
+    int columns = list[2].toInt();
+    int count = list[4].toInt();
+
+    if (rows < 0 || columns < 0 || rows > SparseMatrixMaxRows) {
+        qWarning() << Q_FUNC_INFO << "Invalid dimensions" << rows << columns;
+        ok = false;
+        return SparseMatrix<T>();
+    }
+    // count is checked against the payload before count * 3 can overflow
+    if (count < 0 || count > (list.size() - 5) / 3 || (list.size() - 5) != count * 3) {
+        qWarning() << Q_FUNC_INFO << "Size does not match" << list.size() << count;
+        ok = false;
+        return SparseMatrix<T>();
+    }
+
+    QStringList valueList;
+    valueList.reserve(count);
+    for (int i = 0; i < count; i++) {
+        valueList.append(list[5 + i * 3 + 2]);
+    }
+    QVector<T> values;
+    values.reserve(count);
+    edhMatrixConvert(values, valueList);
+
+    QVector<typename SparseMatrix<T>::Entry> entries;
+    entries.reserve(count);
+    for (int i = 0; i < count; i++) {
+        entries.append({list[5 + i * 3].toInt(), list[5 + i * 3 + 1].toInt(), values[i]});
+    }
+
+    ok = true;
+    return SparseMatrix<T>::fromEntries(rows, columns, entries);
+}
+
 template <typename T>
 QVector<T> Serialization::qStringToQVector(QStringList &list, bool &ok) {
     if (list.size() < 3) {
@@ -363,6 +481,45 @@ QVariant Serialization::deserializeTagValue(QMetaType::Type type, const QString
                         break;
                     }
                 }
+            } else if (userType == QStringLiteral("EDHSparseMatrix")) {
+                bool ok;
+                QStringList list = deserializeHashList(string);
+                QMetaType::Type type = edhMatrixType(list, ok);
+                if (ok) {
+                    switch (type) {
+                    case QMetaType::Bool: {
+                        SparseMatrix<bool> matrix = qStringToSparseMatrix<bool>(list, ok);
+                        if (ok) {
+                            variantValue = QVariant::fromValue(matrix);
+                        }
+                    }
+                        break;
+                    case QMetaType::Int: {
+                        SparseMatrix<int> matrix = qStringToSparseMatrix<int>(list, ok);
+                        if (ok) {
+                            variantValue = QVariant::fromValue(matrix);
+                        }
+                    }
+                        break;
+                    case QMetaType::LongLong: {
+                        SparseMatrix<qint64> matrix = qStringToSparseMatrix<qint64>(list, ok);
+                        if (ok) {
+                            variantValue = QVariant::fromValue(matrix);
+                        }
+                    }
+                        break;
+                    case QMetaType::Double: {
+                        SparseMatrix<double> matrix = qStringToSparseMatrix<double>(list, ok);
+                        if (ok) {
+                            variantValue = QVariant::fromValue(matrix);
+                        }
+                    }
+                        break;
+                    default:
+                        qWarning() << "Unsupported EDHSparseMatrix type" << type;
+                        break;
+                    }
+                }
             } else if (userType == QStringLiteral("Vector")) {
                 bool ok;
                 QStringList list = deserializeHashList(string);
@@ -427,7 +584,7 @@ QVariant Serialization::deserializeTagValue(QMetaType::Type type, const QString
     return variantValue;
 }
 
-QString Serialization::serializeScalar(const QVariant &value) {
+QString Serialization::scalarToString(const QVariant &value) {
     QMetaType::Type metatype = static_cast<QMetaType::Type>(value.type());
     switch (metatype) {
     case QMetaType::QDateTime:
@@ -440,18 +597,134 @@ QString Serialization::serializeScalar(const QVariant &value) {
         }
     }
     default:
-        return value.toString().replace('\\', "\\\\").replace("\r\n", "\\r\\n").replace('|', "\\|");
+        return value.toString();
+    }
+}
+
+QString Serialization::serializeScalar(const QVariant &value) {
+    return escape(scalarToString(value));
+}
+
+static bool needsEscape(const QChar* data, int size, bool arrayElement) {
+    for (int i = 0; i < size; i++) {
+        ushort c = data[i].unicode();
+        if (c == '\\' || c == '|' || (c == '#' && arrayElement) || (c == '\r' && i + 1 < size && data[i + 1] == QLatin1Char('\n'))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString Serialization::escape(const QString &value, bool arrayElement) {
+    const QChar* data = value.constData();
+    int size = value.size();
+    if (! needsEscape(data, size, arrayElement)) {
+        return value;
+    }
+
+    QString out;
+    out.reserve(size + size / 8 + 4);
+    for (int i = 0; i < size; i++) {
+        QChar c = data[i];
+        switch (c.unicode()) {
+        case '\\':
+            out.append(QLatin1String("\\\\"));
+            break;
+        case '|':
+            out.append(QLatin1String("\\|"));
+            break;
+        case '#':
+            if (arrayElement) {
+                out.append(QLatin1String("\\#"));
+            } else {
+                out.append(c);
+            }
+            break;
+        case '\r':
+            if (i + 1 < size && data[i + 1] == QLatin1Char('\n')) {
+                out.append(QLatin1String("\\r\\n"));
+                i++;
+            } else {
+                out.append(c);
+            }
+            break;
+        default:
+            out.append(c);
+            break;
+        }
+    }
+    return out;
+}
+
+QString Serialization::unescape(const QString &value) {
+    int first = value.indexOf(QLatin1Char('\\'));
+    if (first < 0) {
+        return value;
+    }
+
+    const QChar* data = value.constData();
+    int size = value.size();
+    QString out;
+    out.reserve(size);
+    out.append(data, first);
+
+    for (int i = first; i < size; i++) {
+        QChar c = data[i];
+        if (c != QLatin1Char('\\') || i + 1 == size) {
+            out.append(c);
+            continue;
+        }
+
+        QChar next = data[i + 1];
+        switch (next.unicode()) {
+        case '\\':
+        case '|':
+        case '#':
+            out.append(next);
+            i++;
+            break;
+        case 'r':
+            if (i + 3 < size && data[i + 2] == QLatin1Char('\\') && data[i + 3] == QLatin1Char('n')) {
+                out.append(QLatin1String("\r\n"));
+                i += 3;
+            } else {
+                out.append(c);
+            }
+            break;
+        default:
+            // not an escape we produce, keep it as it is
+            out.append(c);
+            break;
+        }
     }
+    return out;
 }
 
 /*
- * To decode the regular expression, check
- * http://www.regular-expressions.info/lookaround.html#lookbehind
+ * A backslash always escapes the character after it, so an escaped backslash right
+ * before a separator does not hide the separator, as it would with a lookbehind.
  */
+QStringList Serialization::split(const QString &value, QChar separator) {
+    QStringList result;
+    const QChar* data = value.constData();
+    int size = value.size();
+    int start = 0;
+
+    for (int i = 0; i < size; i++) {
+        if (data[i] == QLatin1Char('\\')) {
+            i++;
+        } else if (data[i] == separator) {
+            result.append(value.mid(start, i - start));
+            start = i + 1;
+        }
+    }
+    result.append(value.mid(start));
+    return result;
+}
+
+// elements stay escaped, strings are unescaped as they are converted
 QStringList Serialization::deserializeHashList(const QString& rawstring) {
-    QStringList array = rawstring.split(HashListSplitter);
-    array.replaceInStrings("\\#", "#");
-    return array;
+    return split(rawstring, QLatin1Char('#'));
 }
 
 QVariant Serialization::deserializeScalarValue(QMetaType::Type type, const QString& rv) {
@@ -463,9 +736,9 @@ QVariant Serialization::deserializeScalarValue(QMetaType::Type type, const QStri
     case QMetaType::LongLong:
         return QVariant(rv.toLongLong());
     case QMetaType::QString:
-        return QVariant(deserializeStringValue(rv));
+        return QVariant(unescape(rv));
     case QMetaType::Bool:
-        return QVariant(rv.toLower() == QString("true"));
+        return QVariant(parseBool(QStringRef(&rv)));
     case QMetaType::QDateTime:
         return QVariant(QDateTime::fromMSecsSinceEpoch(rv.toLongLong(), Qt::UTC));
     default:
@@ -473,3 +746,73 @@ QVariant Serialization::deserializeScalarValue(QMetaType::Type type, const QStri
         return QVariant();
     }
 }
+
+/*
+ * Boolean elements never contain an escaped '#', so the string is split in place
+ * without building a QStringList of copies.
+ */
+BitMatrix Serialization::deserializeBitMatrix(const QString &string, bool &ok) {
+    QVector<QStringRef> list = string.splitRef('#');
+    ok = false;
+    if (list.size() < 4 || list[0] != QLatin1String("EDHMatrix") || list[3].toInt() != QMetaType::Bool) {
+        qWarning() << "Dropping faulty boolean EDHMatrix";
+        return BitMatrix();
+    }
+
+    int rows = list[1].toInt();
+    int columns = list[2].toInt();
+    if (rows < 0 || columns < 0 || rows > bit_matrix_max_dimension || columns > bit_matrix_max_dimension) {
+        qWarning() << Q_FUNC_INFO << "Invalid size" << rows << columns;
+        return BitMatrix();
+    }
+    if (rows == 0 || columns == 0) {
+        ok = true;
+        return BitMatrix();
+    }
+    if (qint64(list.size()) - 4 != qint64(rows) * columns) {
+        qWarning() << Q_FUNC_INFO << "Size does not match" << list.size() << qint64(rows) * columns;
+        return BitMatrix();
+    }
+
+    BitMatrix matrix(rows, columns);
+    int idx = 4;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            if (parseBool(list[idx++])) {
+                matrix.setBit(r, c);
+            }
+        }
+    }
+
+    ok = true;
+    return matrix;
+}
+
+BitVector Serialization::deserializeBitVector(const QString &string, bool &ok) {
+    QVector<QStringRef> list = string.splitRef('#');
+    ok = false;
+    if (list.size() < 3 || list[0] != QLatin1String("Vector") || list[2].toInt() != QMetaType::Bool) {
+        qWarning() << "Dropping faulty boolean Vector";
+        return BitVector();
+    }
+
+    int length = list[1].toInt();
+    if (length <= 0) {
+        ok = length == 0;
+        return BitVector();
+    }
+    if (list.size() - 3 != length) {
+        qWarning() << Q_FUNC_INFO << "Size does not match" << list.size() << length;
+        return BitVector();
+    }
+
+    BitVector vector(length);
+    for (int i = 0; i < length; i++) {
+        if (parseBool(list[i + 3])) {
+            vector.setBit(i);
+        }
+    }
+
+    ok = true;
+    return vector;
+}
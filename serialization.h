@@ -10,6 +10,10 @@ namespace Tag {
     class Value;
     class ValueName;
 }
+class BitVector;
+class BitMatrix;
+template <typename T>
+class SparseMatrix;
 
 class Serialization {
 public:
@@ -21,6 +25,21 @@ public:
     static std::tuple<QString, QMetaType::Type> serialize(const QVariant& value);
     static QString serializeScalar(const QVariant& value);
 
+    /**
+     * @brief escape - escape '\\', CRLF and '|' for the line protocol, and '#' as well for array elements
+     * @return the value itself, without a copy, when nothing needs escaping
+     */
+    static QString escape(const QString& value, bool arrayElement = false);
+    /**
+     * @brief unescape - undo escape() in a single pass, for array elements as well
+     * @return the value itself, without a copy, when it contains no escapes
+     */
+    static QString unescape(const QString& value);
+    /**
+     * @brief split - split on every separator that is not escaped by a backslash
+     */
+    static QStringList split(const QString& value, QChar separator);
+
     /**
      * @brief deserializeTagValue - deserilize any valid serialized string, including matrix and vector
      * @param type
@@ -36,10 +55,20 @@ public:
      */
     static QVariant deserializeScalarValue(QMetaType::Type type, const QString& rv);
 
+    /**
+     * @brief deserializeBitMatrix - decode a boolean EDHMatrix straight into packed bits
+     * @param string serialized EDHMatrix with element type Bool
+     * @param ok false when the string is not a well-formed boolean EDHMatrix
+     * @return decoded matrix
+     */
+    static BitMatrix deserializeBitMatrix(const QString& string, bool& ok);
+    static BitVector deserializeBitVector(const QString& string, bool& ok);
+
     static const QRegularExpression HashListSplitter;
     static const QRegularExpression CommandSplitter;
 private:
     static QStringList deserializeHashList(const QString& rawstring);
+    static QString scalarToString(const QVariant& value);
 
     template <typename T>
     static Matrix<T> qStringToEDHMatrix(QStringList& list, bool& ok);
@@ -50,10 +79,16 @@ private:
     template <typename T>
     static QString edhMatrixToQString(const Matrix<T>& matrix);
     template <typename T>
+    static QString sparseMatrixToQString(const SparseMatrix<T>& matrix);
+    template <typename T>
+    static SparseMatrix<T> qStringToSparseMatrix(QStringList& list, bool& ok);
+    template <typename T>
     static QJsonObject edhMatrixToQJsonObject(const Matrix<T>& matrix);
 
     template <template<typename> class container, typename type>
     static QString iterableToQString(const container<type> &ct);
+    static QString bitMatrixToQString(const BitMatrix& matrix);
+    static QString bitVectorToQString(const BitVector& vector);
     template <typename type, template<typename> class container>
     static QJsonObject iterableToQJsonObject(const container<type> &ct);
 
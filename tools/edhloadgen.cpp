@@ -0,0 +1,92 @@
+#include <QUrl>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <cstdio>
+#include <memory>
+
+#include "edhclient.h"
+
+using namespace eDrillingHub;
+
+static void printStats(const char* name, const LatencyStats& stats) {
+    std::printf("  %-18s count %10llu  p50 %9lld us  p99 %9lld us  max %9lld us\n", name,
+                static_cast<unsigned long long>(stats.count),
+                static_cast<long long>(stats.p50),
+                static_cast<long long>(stats.p99),
+                static_cast<long long>(stats.max));
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("edhloadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Subscribes to a hub and reports update throughput and latency");
+    parser.addHelpOption();
+    QCommandLineOption url("url", "Hub url, edh:// or wsedh://", "url", "edh://127.0.0.1:5000");
+    QCommandLineOption tags("tags", "Number of tags to subscribe to", "count", "1000");
+    QCommandLineOption duration("duration", "Measurement time in seconds", "s", "10");
+    QCommandLineOption warmup("warmup", "Seconds to run before measuring", "s", "2");
+    parser.addOptions({url, tags, duration, warmup});
+    parser.process(app);
+
+    std::unique_ptr<Client> client(Client::create(QUrl(parser.value(url))));
+    if (! client) {
+        return 1;
+    }
+
+    int tagCount = parser.value(tags).toInt();
+    int warmupMs = parser.value(warmup).toInt() * 1000;
+    int durationMs = parser.value(duration).toInt() * 1000;
+
+    quint64 updates = 0;
+    QElapsedTimer measured;
+
+    QObject::connect(client.get(), &Client::tagValueUpdated, [&](const QString&, const QDateTime&, QMetaType::Type, const QVariant&) {
+        updates++;
+    });
+    QObject::connect(client.get(), &Client::socketError, [&](QAbstractSocket::SocketError) {
+        std::fprintf(stderr, "edhloadgen: %s\n", qPrintable(client->errorString()));
+        app.exit(1);
+    });
+    QObject::connect(client.get(), &Client::disconnected, [&] {
+        std::fprintf(stderr, "edhloadgen: disconnected\n");
+        app.exit(1);
+    });
+    QObject::connect(client.get(), &Client::connected, [&] {
+        client->setLatencyTracking(true);
+
+        QStringList tags;
+        for (int i = 0; i < tagCount; i++) {
+            tags.append(QString("mock/well%1/sensor%2").arg(i % 10).arg(i));
+        }
+        client->subscribe(tags);
+
+        QTimer::singleShot(warmupMs, [&] {
+            updates = 0;
+            client->latency()->reset();
+            measured.start();
+
+            QTimer::singleShot(durationMs, [&] {
+                double seconds = measured.nsecsElapsed() / 1e9;
+                std::printf("edhloadgen: %d tags, %llu updates in %.2f s, %.0f updates/s\n", tagCount,
+                            static_cast<unsigned long long>(updates), seconds, updates / seconds);
+
+                LatencyTracker* latency = client->latency();
+                printStats("sample->receipt", latency->stats(LatencyTracker::Stage::SampleToReceipt));
+                printStats("receipt->emit", latency->stats(LatencyTracker::Stage::ReceiptToEmit));
+                printStats("queue wait", latency->stats(LatencyTracker::Stage::QueueWait));
+
+                QObject::disconnect(client.get(), &Client::disconnected, nullptr, nullptr);
+                client->close();
+                app.quit();
+            });
+        });
+    });
+
+    client->open();
+    return app.exec();
+}
@@ -0,0 +1,36 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <iostream>
+
+#include "mockhub.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("edhmockhub");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local stand-in for an eDrilling Hub");
+    parser.addHelpOption();
+    QCommandLineOption tcpPort("tcp-port", "Port for edh:// clients", "port", "5000");
+    QCommandLineOption wsPort("ws-port", "Port for wsedh:// clients", "port", "5001");
+    QCommandLineOption tags("tags", "Number of tags served", "count", "1000");
+    QCommandLineOption rate("rate", "Updates per second per subscribed tag", "hz", "1");
+    QCommandLineOption rangePeriod("range-period", "Milliseconds between samples of range reads", "ms", "1000");
+    parser.addOptions({tcpPort, wsPort, tags, rate, rangePeriod});
+    parser.process(app);
+
+    MockHub::Options options;
+    options.tags = parser.value(tags).toInt();
+    options.rate = parser.value(rate).toDouble();
+    options.rangePeriod = parser.value(rangePeriod).toLongLong();
+
+    MockHub hub(options);
+    if (! hub.listen(quint16(parser.value(tcpPort).toUInt()), quint16(parser.value(wsPort).toUInt()))) {
+        return 1;
+    }
+
+    std::cout << "edhmockhub: serving " << options.tags << " tags on edh://127.0.0.1:" << parser.value(tcpPort).toStdString()
+              << " and wsedh://127.0.0.1:" << parser.value(wsPort).toStdString() << std::endl;
+    return app.exec();
+}
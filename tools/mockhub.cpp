@@ -0,0 +1,245 @@
+#include "mockhub.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QDebug>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtWebSockets/QWebSocket>
+#include <QtWebSockets/QWebSocketServer>
+
+#include "edhprotocol.h"
+
+static const QByteArray line_end("\r\n");
+
+MockHub::MockHub(const Options &options, QObject *parent) :
+    QObject(parent),
+    _options(options)
+{
+    for (int i = 0; i < _options.tags; i++) {
+        QString name = QString("mock/well%1/sensor%2").arg(i % 10).arg(i);
+        _tags.append(name);
+        _tagIndex.insert(name, i);
+    }
+
+    connect(&_ticker, &QTimer::timeout, this, &MockHub::tick);
+    _ticker.start(_options.tickInterval);
+
+    connect(&_servertime, &QTimer::timeout, this, [this] {
+        QString line = QString("servertime|%1").arg(QDateTime::currentMSecsSinceEpoch());
+        for (auto connection : _connections) {
+            send(connection, line);
+            flush(connection);
+        }
+    });
+    _servertime.start(1000);
+}
+
+MockHub::~MockHub() {
+    qDeleteAll(_connections);
+}
+
+bool MockHub::listen(quint16 tcpPort, quint16 wsPort) {
+    _tcp = new QTcpServer(this);
+    if (! _tcp->listen(QHostAddress::LocalHost, tcpPort)) {
+        qWarning() << "MockHub: unable to listen on tcp port" << tcpPort << _tcp->errorString();
+        return false;
+    }
+    connect(_tcp, &QTcpServer::newConnection, this, &MockHub::onTcpConnection);
+
+    _ws = new QWebSocketServer("edhmockhub", QWebSocketServer::NonSecureMode, this);
+    if (! _ws->listen(QHostAddress::LocalHost, wsPort)) {
+        qWarning() << "MockHub: unable to listen on websocket port" << wsPort << _ws->errorString();
+        return false;
+    }
+    connect(_ws, &QWebSocketServer::newConnection, this, &MockHub::onWsConnection);
+
+    return true;
+}
+
+QString MockHub::tagName(int index) const {
+    return _tags.value(index);
+}
+
+void MockHub::onTcpConnection() {
+    while (_tcp->hasPendingConnections()) {
+        auto connection = new Connection();
+        connection->socket = _tcp->nextPendingConnection();
+        connection->socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        _connections.append(connection);
+
+        connect(connection->socket, &QTcpSocket::readyRead, this, [this, connection] {
+            onTcpReadyRead(connection);
+        });
+        connect(connection->socket, &QTcpSocket::disconnected, this, [this, connection] {
+            drop(connection);
+        });
+    }
+}
+
+void MockHub::onWsConnection() {
+    while (_ws->hasPendingConnections()) {
+        auto connection = new Connection();
+        connection->ws = _ws->nextPendingConnection();
+        _connections.append(connection);
+
+        connect(connection->ws, &QWebSocket::textMessageReceived, this, [this, connection](const QString& message) {
+            handle(connection, message);
+            flush(connection);
+        });
+        connect(connection->ws, &QWebSocket::disconnected, this, [this, connection] {
+            drop(connection);
+        });
+    }
+}
+
+void MockHub::onTcpReadyRead(Connection *connection) {
+    connection->readBuffer.append(connection->socket->readAll());
+
+    int idx = 0;
+    int pos;
+    while ((pos = connection->readBuffer.indexOf(line_end, idx)) >= 0) {
+        handle(connection, QString::fromUtf8(connection->readBuffer.mid(idx, pos - idx)));
+        idx = pos + line_end.size();
+    }
+    connection->readBuffer.remove(0, idx);
+    flush(connection);
+}
+
+void MockHub::drop(Connection *connection) {
+    _connections.removeOne(connection);
+    if (connection->socket) {
+        connection->socket->deleteLater();
+    }
+    if (connection->ws) {
+        connection->ws->deleteLater();
+    }
+    delete connection;
+}
+
+void MockHub::send(Connection *connection, const QString &line) {
+    if (connection->socket) {
+        connection->writeBuffer.append(line.toUtf8());
+        connection->writeBuffer.append(line_end);
+    } else {
+        connection->ws->sendTextMessage(line);
+    }
+}
+
+void MockHub::sendBinary(Connection *connection, const QByteArray &data) {
+    if (connection->ws) {
+        connection->ws->sendBinaryMessage(data);
+    }
+}
+
+void MockHub::flush(Connection *connection) {
+    if (connection->socket && ! connection->writeBuffer.isEmpty()) {
+        connection->socket->write(connection->writeBuffer);
+        connection->writeBuffer.clear();
+    }
+}
+
+double MockHub::value(int tag, qint64 timestamp) const {
+    return std::sin(timestamp / 1000.0 + tag) * 100.0 + tag;
+}
+
+QString MockHub::tagLine(const QString &tag, qint64 timestamp) const {
+    return QString("%1|%2|%3|%4|m|GOOD")
+            .arg(tag)
+            .arg(timestamp)
+            .arg(int(QMetaType::Double))
+            .arg(value(_tagIndex.value(tag), timestamp), 0, 'g', 12);
+}
+
+void MockHub::handle(Connection *connection, const QString &line) {
+    QStringList splits = line.trimmed().split('|');
+    const QString& command = splits[0];
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (command == "browse") {
+        for (const auto& tag : _tags) {
+            send(connection, "browse|" + tagLine(tag, now));
+        }
+        send(connection, "browse|end");
+    } else if (command == "subscribe" && splits.size() >= 2) {
+        if (! _tagIndex.contains(splits[1])) {
+            send(connection, QString("subscribe|error|%1").arg(splits[1]));
+            return;
+        }
+        if (! connection->subscriptions.contains(splits[1])) {
+            connection->subscriptions.append(splits[1]);
+        }
+        send(connection, "subscribe|ok|" + tagLine(splits[1], now));
+    } else if (command == "unsubscribe") {
+        if (splits.size() >= 2) {
+            connection->subscriptions.removeAll(splits[1]);
+        } else {
+            connection->subscriptions.clear();
+        }
+    } else if (command == "read" && splits.size() == 2) {
+        send(connection, "read|" + tagLine(splits[1], now));
+    } else if (command == "read" && splits.size() >= 4) {
+        const QString& tag = splits[1];
+        qint64 from = splits[2].toLongLong();
+        qint64 to = splits[3].toLongLong();
+        qint64 period = std::max<qint64>(_options.rangePeriod, 1);
+
+        send(connection, QString("readStart|%1|%2|%3").arg(tag).arg(from).arg(to));
+        for (qint64 ts = (from + period - 1) / period * period; ts <= to && ts <= now; ts += period) {
+            send(connection, "read|" + tagLine(tag, ts));
+        }
+        send(connection, QString("readEnd|%1").arg(tag));
+    } else if (command == "db" && splits.size() >= 3 && splits[1] == "range") {
+        qint64 start = now - 365LL * 24 * 3600 * 1000;
+        send(connection, QString("db|range|%1|%2|%3").arg(splits[2]).arg(start).arg(now));
+    } else if (command == "file" && splits.size() >= 3 && splits[1] == "transfer") {
+        if (! connection->ws) {
+            send(connection, "file|error|binary transfers need a websocket connection");
+            return;
+        }
+
+        QByteArray content = QCryptographicHash::hash(splits[2].toUtf8(), QCryptographicHash::Sha256).repeated(4096);
+        QCryptographicHash hash(eDrillingHub::Protocol::hashing_algorithm);
+        hash.addData(content);
+
+        send(connection, QString("file|ok|%1").arg(content.size()));
+        for (int offset = 0; offset < content.size(); offset += 65536) {
+            sendBinary(connection, content.mid(offset, 65536));
+        }
+        send(connection, QString("file|done|%1").arg(QString(hash.result().toHex())));
+    } else if (command == "write" || command == "session" || command == "config") {
+        // accepted, nothing to store
+    } else {
+        qWarning() << "MockHub: unsupported command" << line;
+    }
+}
+
+void MockHub::tick() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    for (auto connection : _connections) {
+        int subscribed = connection->subscriptions.size();
+        if (subscribed == 0) {
+            continue;
+        }
+
+        // spread the updates evenly over the ticks of a second
+        connection->credit += subscribed * _options.rate * _options.tickInterval / 1000.0;
+        int updates = static_cast<int>(connection->credit);
+        connection->credit -= updates;
+
+        for (int i = 0; i < updates; i++) {
+            connection->cursor = (connection->cursor + 1) % subscribed;
+            const QString& tag = connection->subscriptions[connection->cursor];
+            send(connection, QString("subscription|value|%1|%2|%3|%4")
+                 .arg(tag)
+                 .arg(now)
+                 .arg(int(QMetaType::Double))
+                 .arg(value(_tagIndex.value(tag), now), 0, 'g', 12));
+        }
+        flush(connection);
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QStringList>
+
+class QTcpServer;
+class QTcpSocket;
+class QWebSocket;
+class QWebSocketServer;
+
+/**
+ * @brief MockHub - local stand-in for an eDrilling Hub
+ *
+ * Speaks the browse/subscribe/read/readStart/readEnd/db/file subset the client
+ * understands, over plain TCP and WebSocket. Subscribed tags receive synthetic
+ * values stamped with the current time, so receivers can measure latency. File
+ * transfers are served from generated content over WebSocket only, as the TCP
+ * client does not read binary data.
+ */
+class MockHub : public QObject {
+    Q_OBJECT
+public:
+    struct Options {
+        int tags = 1000;
+        double rate = 1.0;          // updates per second per subscribed tag
+        qint64 rangePeriod = 1000;  // ms between samples of a range read
+        int tickInterval = 10;      // ms
+    };
+
+    MockHub(const Options& options, QObject* parent = nullptr);
+    virtual ~MockHub();
+
+    bool listen(quint16 tcpPort, quint16 wsPort);
+    QString tagName(int index) const;
+private:
+    struct Connection {
+        QTcpSocket* socket = nullptr;
+        QWebSocket* ws = nullptr;
+        QByteArray readBuffer;
+        QByteArray writeBuffer;
+        QStringList subscriptions;
+        int cursor = 0;
+        double credit = 0;
+    };
+
+    void onTcpConnection();
+    void onWsConnection();
+    void onTcpReadyRead(Connection* connection);
+    void drop(Connection* connection);
+
+    void handle(Connection* connection, const QString& line);
+    void send(Connection* connection, const QString& line);
+    void sendBinary(Connection* connection, const QByteArray& data);
+    void flush(Connection* connection);
+    void tick();
+
+    double value(int tag, qint64 timestamp) const;
+    QString tagLine(const QString& tag, qint64 timestamp) const;
+
+    Options _options;
+    QStringList _tags;
+    QHash<QString, int> _tagIndex;
+    QList<Connection*> _connections;
+
+    QTcpServer* _tcp = nullptr;
+    QWebSocketServer* _ws = nullptr;
+    QTimer _ticker;
+    QTimer _servertime;
+};